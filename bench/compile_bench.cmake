@@ -0,0 +1,67 @@
+# Generate translation unit with STATEMENTS log statements
+#
+# usage: cmake -DOUTPUT=file.cpp -DSTATEMENTS=1000 -P compile_bench.cmake
+
+if (NOT OUTPUT)
+    message(FATAL_ERROR "OUTPUT is not set")
+endif()
+if (NOT STATEMENTS)
+    set(STATEMENTS 1000)
+endif()
+
+# Statements per generated function
+set(group_size 10)
+
+# Format templates, {N} is replaced with statement number
+set(formats
+    "statement {N}: id={} qty={}"
+    "statement {N}: order {} price {.2} side {} account {}"
+    "statement {N}: flags {x} mask {08x} text {}"
+    "statement {N}: {} {} {} {} {} {} {} {}"
+    "statement {N}: session {} opened by {} at {} (attempt {}), latency {.3} us"
+)
+set(arguments
+    "i, u"
+    "u, d, c, s"
+    "u, u, s"
+    "i, u, d, c, s, i, u, d"
+    "i, s, u, i, d"
+)
+list(LENGTH formats format_count)
+
+set(content "// Generated by compile_bench.cmake, do not edit\n\n")
+string(APPEND content "#include <cstdint>\n#include \"logfw/backend.hpp\"\n#include \"logfw/log.hpp\"\n\n")
+string(APPEND content "using namespace logfw;\n\n")
+
+math(EXPR last "${STATEMENTS} - 1")
+set(function 0)
+foreach (index RANGE ${last})
+    math(EXPR position "${index} % ${group_size}")
+    if (position EQUAL 0)
+        string(APPEND content "void statements_${function}(backend& b, std::int64_t i, std::uint32_t u, double d, char c, const char* s)\n{\n")
+    endif()
+
+    math(EXPR kind "${index} % ${format_count}")
+    list(GET formats ${kind} format)
+    list(GET arguments ${kind} args)
+    string(REPLACE "{N}" "${index}" format "${format}")
+    string(APPEND content "    LOGFW_INFO(b, \"bench\", \"${format}\", ${args});\n")
+
+    math(EXPR position "${index} % ${group_size} + 1")
+    if (position EQUAL group_size OR index EQUAL last)
+        string(APPEND content "}\n\n")
+        math(EXPR function "${function} + 1")
+    endif()
+endforeach()
+
+string(APPEND content "int main(int argc, char*[])\n{\n")
+string(APPEND content "    /* Statements are compiled, not executed */\n")
+string(APPEND content "    if (argc < 1000) {\n        return 0;\n    }\n\n")
+string(APPEND content "    backend b;\n")
+math(EXPR last_function "${function} - 1")
+foreach (index RANGE ${last_function})
+    string(APPEND content "    statements_${index}(b, argc, argc, argc, 'x', \"text\");\n")
+endforeach()
+string(APPEND content "    return 0;\n}\n")
+
+file(WRITE ${OUTPUT} "${content}")
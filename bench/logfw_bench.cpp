@@ -0,0 +1,384 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "logfw/backend.hpp"
+#include "logfw/buffer.hpp"
+#include "logfw/clock.hpp"
+#include "logfw/encoder.hpp"
+#include "logfw/format_program.hpp"
+#include "logfw/make_format.hpp"
+#include "logfw/write.hpp"
+
+/*
+ * Micro benchmarks, results are printed as JSON to stdout:
+ *
+ * {"benchmarks": [{"name": "...", "metric": value, ...}, ...]}
+ *
+ * Build with CMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+
+using namespace logfw;
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+/** Bench settings */
+struct bench_options
+{
+    /* Iterations of encode benchmarks */
+    std::size_t encode_iterations = 10000000;
+    /* Records of decode benchmarks */
+    std::size_t decode_records = 1000000;
+    /* Records per producer thread of latency benchmark */
+    std::size_t latency_records = 200000;
+    /* Producer threads of latency benchmark */
+    std::size_t threads = 4;
+};
+
+/* Prevent compiler from optimizing value away */
+template< class T >
+inline void do_not_optimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+double seconds_since(bench_clock::time_point start)
+{
+    return std::chrono::duration< double >(bench_clock::now() - start).count();
+}
+
+/** JSON results printer */
+class report
+{
+private:
+    bool first_{true};
+
+public:
+    report()
+    {
+        std::printf("{\"benchmarks\": [");
+    }
+
+    ~report()
+    {
+        std::printf("\n]}\n");
+    }
+
+    /** Print result {"name": name, metrics...} */
+    void add(std::string_view name, std::initializer_list< std::pair< const char*, double > > metrics)
+    {
+        std::printf("%s\n  {\"name\": \"%.*s\"", first_ ? "" : ",", int(name.size()), name.data());
+        for (const auto& [key, value]: metrics) {
+            std::printf(", \"%s\": %.3f", key, value);
+        }
+        std::printf("}");
+        std::fflush(stdout);
+        first_ = false;
+    }
+};
+
+/* Format holders */
+struct int_format { static constexpr const char* data() { return "value={}"; } };
+struct mixed_format { static constexpr const char* data() { return "order id={} qty={} price={.2} side={}"; } };
+struct string_format { static constexpr const char* data() { return "symbol={} venue={}"; } };
+
+/** Run f(i) iterations times, add ns/op result */
+template< class F >
+void run_encode(report& r, std::string_view name, std::size_t iterations, F&& f)
+{
+    /* Warm up */
+    for (std::size_t i = 0; i < iterations / 10; ++i) {
+        f(i);
+    }
+
+    const auto start = bench_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        f(i);
+    }
+    const double elapsed = seconds_since(start);
+
+    r.add(name, {
+        {"ns_per_op", elapsed * 1e9 / iterations},
+        {"ops_per_sec", iterations / elapsed}
+    });
+}
+
+void bench_encode(report& r, const bench_options& options)
+{
+    alignas(8) char buffer[1024];
+    const std::size_t n = options.encode_iterations;
+
+    run_encode(r, "encode/int", n, [&](std::size_t i) {
+        do_not_optimize(encoder::encode(buffer, int(i)));
+        do_not_optimize(buffer);
+    });
+
+    run_encode(r, "encode/mixed", n, [&](std::size_t i) {
+        const char* side = (i & 1) ? "buy" : "sell";
+        do_not_optimize(encoder::encode(buffer, std::uint64_t(i), int(i), double(i) * 0.25, side));
+        do_not_optimize(buffer);
+    });
+
+    run_encode(r, "encode/compact_mixed", n, [&](std::size_t i) {
+        const char* side = (i & 1) ? "buy" : "sell";
+        do_not_optimize(basic_encoder< compact_encoding >::encode(buffer, std::uint64_t(i), int(i), double(i) * 0.25, side));
+        do_not_optimize(buffer);
+    });
+
+    const std::string symbol = "ESZ8.CME.FUTURES";
+    const std::string_view venue = "GLOBEX";
+    run_encode(r, "encode/string", n, [&](std::size_t) {
+        do_not_optimize(encoder::encode(buffer, symbol, venue));
+        do_not_optimize(buffer);
+    });
+}
+
+/** Encode records count times, render with f(buf, payload, size), add throughput */
+template< class Encode, class Render >
+void run_decode(report& r, std::string_view name, std::size_t count, Encode&& encode, Render&& render)
+{
+    /* Encoded records: [size][payload] */
+    std::vector< char > records;
+    records.reserve(count * 64);
+    for (std::size_t i = 0; i < count; ++i) {
+        char payload[512];
+        const std::uint32_t size = static_cast< std::uint32_t >(encode(payload, i));
+        const char* bytes = reinterpret_cast< const char* >(&size);
+        records.insert(records.end(), bytes, bytes + sizeof(size));
+        records.insert(records.end(), payload, payload + size);
+    }
+
+    buffer buf{64 * 1024};
+    std::size_t output = 0;
+
+    const auto start = bench_clock::now();
+    for (std::size_t pos = 0; pos < records.size();) {
+        std::uint32_t size;
+        std::memcpy(&size, records.data() + pos, sizeof(size));
+        pos += sizeof(size);
+
+        render(buf, records.data() + pos, size);
+        buf.push_back('\n');
+        pos += size;
+
+        if (buf.size() > 60 * 1024) {
+            output += buf.size();
+            do_not_optimize(buf.data());
+            buf.clear();
+        }
+    }
+    output += buf.size();
+    const double elapsed = seconds_since(start);
+
+    const std::size_t input = records.size() - count * sizeof(std::uint32_t);
+    r.add(name, {
+        {"records_per_sec", count / elapsed},
+        {"bytes_per_record", double(input) / count},
+        {"input_mb_per_sec", input / elapsed / 1e6},
+        {"output_mb_per_sec", output / elapsed / 1e6}
+    });
+}
+
+void bench_decode(report& r, const bench_options& options)
+{
+    using int_fmt = make_format< int_format, int >;
+    using mixed_fmt = make_format< mixed_format, std::uint64_t, int, double, const char* >;
+
+    auto encode_int = [](char* payload, std::size_t i) {
+        return encoder::encode(payload, int(i));
+    };
+    auto encode_mixed = [](char* payload, std::size_t i) {
+        const char* side = (i & 1) ? "buy" : "sell";
+        return encoder::encode(payload, std::uint64_t(i), int(i), double(i) * 0.25, side);
+    };
+    auto encode_compact_mixed = [](char* payload, std::size_t i) {
+        const char* side = (i & 1) ? "buy" : "sell";
+        return basic_encoder< compact_encoding >::encode(payload, std::uint64_t(i), int(i), double(i) * 0.25, side);
+    };
+
+    /* Format is parsed for each record */
+    run_decode(r, "write/int", options.decode_records, encode_int,
+            [](buffer& buf, const char* payload, std::size_t size) {
+                write(buf, int_fmt::str(), payload, size);
+            });
+    run_decode(r, "write/mixed", options.decode_records, encode_mixed,
+            [](buffer& buf, const char* payload, std::size_t size) {
+                write(buf, mixed_fmt::str(), payload, size);
+            });
+
+    /* Format is parsed at compile time (backend render path) */
+    run_decode(r, "format_ops/int", options.decode_records, encode_int,
+            [](buffer& buf, const char* payload, std::size_t size) {
+                const auto& ops = int_fmt::segments();
+                details::run_format_ops(buf, int_fmt::data(), ops.data(), ops.size(), payload, size);
+            });
+    run_decode(r, "format_ops/mixed", options.decode_records, encode_mixed,
+            [](buffer& buf, const char* payload, std::size_t size) {
+                const auto& ops = mixed_fmt::segments();
+                details::run_format_ops(buf, mixed_fmt::data(), ops.data(), ops.size(), payload, size);
+            });
+    run_decode(r, "format_ops/compact_mixed", options.decode_records, encode_compact_mixed,
+            [](buffer& buf, const char* payload, std::size_t size) {
+                const auto& ops = mixed_fmt::segments();
+                details::run_format_ops< compact_encoding >(buf, mixed_fmt::data(), ops.data(), ops.size(),
+                        payload, size);
+            });
+}
+
+/** Discards rendered records */
+class null_sink final
+    : public sink
+{
+public:
+    void write(std::string_view record) override
+    {
+        do_not_optimize(record.data());
+    }
+};
+
+void bench_latency(report& r, const bench_options& options)
+{
+    backend_options backend_opts;
+    backend_opts.mode = wait_mode::busy_poll;
+    backend b{backend_opts};
+    b.add_sink< null_sink >();
+    b.start();
+
+    /* Latency is measured in record_clock ticks when available */
+    const double ns_per_tick = record_clock::calibrated ? clock_calibration{}.params().ns_per_tick : 1.0;
+    auto now = []() -> std::uint64_t {
+        if constexpr (record_clock::calibrated) {
+            return record_clock::now();
+        } else {
+            return steady_clock::now();
+        }
+    };
+
+    std::vector< std::vector< std::uint64_t > > samples(options.threads);
+    std::atomic< std::size_t > ready{0};
+    std::vector< std::thread > threads;
+
+    for (std::size_t id = 0; id < options.threads; ++id) {
+        threads.emplace_back([&, id] {
+            auto& result = samples[id];
+            result.reserve(options.latency_records);
+
+            /* Create queue outside of measurement */
+            b.local_queue();
+            ready.fetch_add(1);
+            while (ready.load() < options.threads) {
+                std::this_thread::yield();
+            }
+
+            for (std::size_t i = 0; i < options.latency_records; ++i) {
+                const char* side = (i & 1) ? "buy" : "sell";
+                const std::uint64_t start = now();
+                while (!b.enqueue< mixed_format >(std::uint64_t(i), int(id), double(i) * 0.25, side)) {
+                    /* Queue full time is a part of latency */
+                }
+                result.push_back(now() - start);
+
+                /* Pace producers, not a throughput test */
+                for (int spin = 0; spin < 64; ++spin) {
+                    do_not_optimize(spin);
+                }
+            }
+        });
+    }
+
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    b.stop();
+
+    std::vector< std::uint64_t > all;
+    for (const auto& result: samples) {
+        all.insert(all.end(), result.begin(), result.end());
+    }
+    std::sort(all.begin(), all.end());
+
+    auto percentile = [&](double p) {
+        const std::size_t index = std::min(all.size() - 1, static_cast< std::size_t >(p * all.size()));
+        return all[index] * ns_per_tick;
+    };
+
+    const std::string name = "enqueue_latency/threads:" + std::to_string(options.threads);
+    r.add(name, {
+        {"p50_ns", percentile(0.5)},
+        {"p99_ns", percentile(0.99)},
+        {"p999_ns", percentile(0.999)},
+        {"max_ns", all.back() * ns_per_tick},
+        {"records", double(all.size())}
+    });
+}
+
+void usage(const char* name)
+{
+    std::fprintf(stderr,
+            "Usage: %s [-q] [-t THREADS] [encode] [decode] [latency]\n"
+            "Run benchmarks (all by default), print results as JSON\n"
+            "\n"
+            "  -q          quick run with fewer iterations\n"
+            "  -t THREADS  producer threads of latency benchmark (default 4)\n",
+            name);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    bench_options options;
+    bool encode = false;
+    bool decode = false;
+    bool latency = false;
+
+    for (int index = 1; index < argc; ++index) {
+        const std::string_view arg = argv[index];
+        if (arg == "-q") {
+            options.encode_iterations /= 20;
+            options.decode_records /= 20;
+            options.latency_records /= 20;
+        } else if (arg == "-t" && index + 1 < argc) {
+            options.threads = std::max(1, std::atoi(argv[++index]));
+        } else if (arg == "encode") {
+            encode = true;
+        } else if (arg == "decode") {
+            decode = true;
+        } else if (arg == "latency") {
+            latency = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!encode && !decode && !latency) {
+        encode = decode = latency = true;
+    }
+
+    report r;
+    if (encode) {
+        bench_encode(r, options);
+    }
+    if (decode) {
+        bench_decode(r, options);
+    }
+    if (latency) {
+        bench_latency(r, options);
+    }
+
+    return 0;
+}
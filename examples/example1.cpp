@@ -0,0 +1,56 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "logfw/backend.hpp"
+#include "logfw/binary_sink.hpp"
+
+using namespace logfw;
+
+template< class Site, class... Args >
+inline void log_impl(backend& b, const Args&... args)
+{
+    while (!b.enqueue< Site >(args...)) {
+        std::this_thread::yield();
+    }
+}
+
+#define log(backend, fmt, ...)                                                          \
+    {                                                                                   \
+        LOGFW_DEFINE_SITE(site, fmt);                                                   \
+        log_impl< site >(backend, ##__VA_ARGS__);                                       \
+    }
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
+{
+    backend_options options;
+    options.mode = wait_mode::futex;
+
+    backend b{options};
+    b.add_sink< ostream_sink >(std::cout);
+    if (argc > 1) {
+        /* Also store encoded records, see logfw-decode */
+        b.add_sink< binary_file_sink >(argv[1]);
+    }
+    b.start();
+
+    std::vector< std::thread > threads;
+    for (int id = 0; id < 4; ++id) {
+        threads.emplace_back([&b, id] {
+            for (int i = 0; i < 5; ++i) {
+                log(b, "thread={} iteration={} value={.2}", id, i, i * 0.5);
+            }
+        });
+    }
+
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    b.stop();
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_array_view_171018120412
+#define KSERGEY_array_view_171018120412
+
+#include <cstddef>
+
+namespace logfw {
+
+/**
+ * Non-owning view of contiguous elements.
+ *
+ * Contiguous ranges of arithmetic types (std::vector, std::array, C arrays)
+ * are logged as "[a, b, c]" directly. array_view makes a range from a pointer
+ * and a size, e.g. encoder::encode(buf, array_view{ptr, n}).
+ */
+template< class T >
+class array_view
+{
+private:
+    const T* data_{nullptr};
+    std::size_t size_{0};
+
+public:
+    constexpr array_view() noexcept = default;
+
+    constexpr array_view(const T* data, std::size_t size) noexcept
+        : data_(data)
+        , size_(size)
+    {}
+
+    /** @return Pointer to the first element */
+    constexpr const T* data() const noexcept
+    {
+        return data_;
+    }
+
+    /** @return Number of elements */
+    constexpr std::size_t size() const noexcept
+    {
+        return size_;
+    }
+};
+
+template< class T >
+array_view(T*, std::size_t) -> array_view< T >;
+
+} /* namespace logfw */
+
+#endif /* KSERGEY_array_view_171018120412 */
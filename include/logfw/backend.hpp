@@ -0,0 +1,774 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_backend_031018113410
+#define KSERGEY_backend_031018113410
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "buffer.hpp"
+#include "clock.hpp"
+#include "compiler.hpp"
+#include "format_program.hpp"
+#include "format_registry.hpp"
+#include "record.hpp"
+#include "sink.hpp"
+#include "spill_queue.hpp"
+#include "spsc_ring.hpp"
+#include "stats.hpp"
+#include "details/futex.hpp"
+
+namespace logfw {
+
+/** Backend thread behaviour when there are no records */
+enum class wait_mode
+{
+    /* Poll queues without pause */
+    busy_poll,
+    /* Poll queues spin_count times then sleep for sleep_duration */
+    adaptive,
+    /* Poll queues spin_count times then sleep until producer wakes up backend */
+    futex
+};
+
+/** Producer behaviour when its queue is full */
+enum class overflow_policy
+{
+    /* Drop the record, the gap is reported with "N records dropped" record */
+    drop,
+    /* Wait until backend frees space, requires running backend; records which never fit are dropped */
+    block,
+    /* Retry overflow_spin_count times then drop */
+    spin,
+    /* Keep records in heap-allocated chunks until the queue has space */
+    spill
+};
+
+/** Backend settings */
+struct backend_options
+{
+    /* Wait strategy */
+    wait_mode mode = wait_mode::adaptive;
+    /* Number of empty polls before sleep */
+    std::size_t spin_count = 1000;
+    /* Sleep duration in adaptive mode, max sleep duration in futex mode */
+    std::chrono::microseconds sleep_duration{100};
+    /* Pin backend thread to the CPU, -1 for no pinning */
+    int cpu = -1;
+    /* Per-thread queue size in bytes */
+    std::size_t queue_capacity = 1024 * 1024;
+    /* Full queue behaviour */
+    overflow_policy overflow = overflow_policy::drop;
+    /* Number of retries in spin overflow mode */
+    std::size_t overflow_spin_count = 10000;
+    /* Spill chunk size in bytes in spill overflow mode */
+    std::size_t spill_chunk_size = 64 * 1024;
+    /* Max records consumed from a queue at once */
+    std::size_t batch_size = 1024;
+    /* Prefix rendered records with wall-clock time (see LOGFW_CLOCK) */
+    bool timestamps = true;
+    /* Interval between record clock calibrations */
+    std::chrono::milliseconds calibration_interval{1000};
+    /* Interval between stats records (see backend_stats), zero to disable */
+    std::chrono::milliseconds stats_interval{0};
+    /* Measure render and sink write time (see backend_stats), costs clock reads per record */
+    bool timing = false;
+    /* Max interval between sink flushes while there are no records (see sink::flush()) */
+    std::chrono::milliseconds idle_flush_interval{100};
+};
+
+/**
+ * Logging backend.
+ *
+ * Owns per-thread record queues. Backend thread drains queues, renders
+ * records and hands output to sinks. A thread logging into several backends
+ * has a queue in each of them.
+ *
+ * Full queue is handled according to overflow_policy. Dropped records are
+ * replaced with a single "N records dropped" record at the next successful
+ * enqueue of the thread. Spilled records are moved into the queue by next
+ * enqueue of the thread or by backend after the thread exits. Drop and spin
+ * modes never allocate.
+ *
+ * Producer and backend counters are updated without locked instructions
+ * and could be read from any thread (see stats()).
+ */
+class backend
+{
+private:
+    /* Per-thread queue */
+    struct thread_queue
+    {
+        spsc_ring ring;
+
+        /* Producer owned overflow state */
+        spill_queue spill;
+        /* Number of dropped records not yet reported */
+        std::uint64_t dropped{0};
+
+        details::queue_counters stats;
+
+        thread_queue(std::size_t capacity, std::size_t spill_chunk_size)
+            : ring(capacity)
+            , spill(spill_chunk_size)
+        {}
+
+        /** @return true if there are no spilled or unreported dropped records */
+        LOGFW_FORCE_INLINE bool clean() const noexcept
+        {
+            return dropped == 0 && spill.empty();
+        }
+
+        /**
+         * Move spilled records into the ring and report dropped records (producer side).
+         * @return false if the ring is full
+         */
+        bool flush()
+        {
+            std::size_t size;
+            while (const char* frame = spill.front(size)) {
+                if (LOGFW_UNLIKELY(size > ring.max_frame_size())) {
+                    /* Never fits */
+                    spill.pop();
+                    ++dropped;
+                    stats.dropped.add(1);
+                    continue;
+                }
+                char* buffer = ring.reserve(size);
+                if (!buffer) {
+                    return false;
+                }
+                std::memcpy(buffer, frame, size);
+                ring.commit(size);
+                spill.pop();
+            }
+
+            if (dropped > 0) {
+                if (!enqueue_dropped(ring, dropped)) {
+                    return false;
+                }
+                dropped = 0;
+            }
+            return true;
+        }
+    };
+
+    /* Thread local reference to the queue of a backend */
+    struct queue_ref
+    {
+        std::uint64_t owner;
+        std::shared_ptr< thread_queue > queue;
+    };
+
+    backend_options options_;
+
+    /* Unique backend id (for thread local queue lookup) */
+    std::uint64_t id_;
+
+    /* All queues, guarded by mutex */
+    std::mutex mutex_;
+    std::vector< std::shared_ptr< thread_queue > > queues_;
+    std::atomic< bool > queues_changed_{false};
+
+    /* Backend thread copy of queues */
+    std::vector< std::shared_ptr< thread_queue > > active_queues_;
+
+    std::vector< std::unique_ptr< sink > > sinks_;
+    std::vector< std::unique_ptr< record_sink > > record_sinks_;
+
+    std::thread thread_;
+    std::atomic< bool > running_{false};
+
+    /* Backend owned counters */
+    alignas(LOGFW_CACHE_LINE_SIZE) details::backend_counters counters_;
+    /* Counters of released queues */
+    producer_stats retired_;
+    /* Age of the oldest record seen by the current poll, in record_clock ticks */
+    std::uint64_t lag_{0};
+    std::chrono::steady_clock::time_point next_stats_{};
+    std::chrono::steady_clock::time_point next_flush_{};
+
+    /* Non-zero while backend thread sleeps in futex mode */
+    alignas(LOGFW_CACHE_LINE_SIZE) std::atomic< std::uint32_t > sleeping_{0};
+
+    /* Record clock to wall-clock mapping */
+    clock_calibration calibration_;
+    std::chrono::steady_clock::time_point next_calibration_{};
+
+    /* Render state */
+    program_cache programs_;
+    buffer buffer_;
+    timestamp_formatter timestamp_;
+
+public:
+    explicit backend(backend_options options = {})
+        : options_(options)
+        , id_(next_id())
+    {}
+
+    backend(const backend&) = delete;
+    backend& operator=(const backend&) = delete;
+
+    ~backend()
+    {
+        stop();
+    }
+
+    /** @return Backend settings */
+    const backend_options& options() const noexcept
+    {
+        return options_;
+    }
+
+    /**
+     * Add sink (derived from sink or record_sink).
+     * Records are rendered only if there is at least one sink of rendered records.
+     * Should be called before start()
+     */
+    template< class Sink, class... SinkArgs >
+    Sink& add_sink(SinkArgs&&... args)
+    {
+        auto s = std::make_unique< Sink >(std::forward< SinkArgs >(args)...);
+        Sink& result = *s;
+        if constexpr (std::is_base_of_v< record_sink, Sink >) {
+            record_sinks_.push_back(std::move(s));
+        } else {
+            sinks_.push_back(std::move(s));
+        }
+        return result;
+    }
+
+    /** Start backend thread */
+    void start()
+    {
+        if (running_.exchange(true)) {
+            return;
+        }
+
+        thread_ = std::thread([this] {
+            run();
+        });
+
+        if (options_.cpu >= 0) {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(options_.cpu, &cpuset);
+            if (::pthread_setaffinity_np(thread_.native_handle(), sizeof(cpuset), &cpuset) != 0) {
+                throw std::runtime_error("Failed to set backend thread affinity");
+            }
+        }
+    }
+
+    /** Stop backend thread, pending records are consumed before exit */
+    void stop()
+    {
+        if (!running_.exchange(false)) {
+            return;
+        }
+
+        wake();
+        thread_.join();
+    }
+
+    /** @return Queue of the calling thread, created on first call */
+    LOGFW_FORCE_INLINE spsc_ring& local_queue()
+    {
+        return local_thread_queue().ring;
+    }
+
+    /**
+     * Encode record into the calling thread queue.
+     * Full queue is handled according to overflow_policy.
+     * @return false if the record is dropped
+     */
+    template< class StringHolder, class... Args >
+    LOGFW_FORCE_INLINE bool enqueue(const Args&... args)
+    {
+        thread_queue& queue = local_thread_queue();
+        const std::size_t size = queue.clean() ? logfw::enqueue_record< StringHolder >(queue.ring, args...) : 0;
+        if (LOGFW_LIKELY(size != 0)) {
+            enqueued(queue, size);
+            return true;
+        }
+        return enqueue_overflow< StringHolder >(queue, args...);
+    }
+
+    /** @return Total number of dropped records, updated on poll */
+    std::uint64_t dropped() const noexcept
+    {
+        return counters_.dropped.load();
+    }
+
+    /**
+     * @return Backend counters.
+     * Producer counters are summed over all threads on each poll.
+     */
+    backend_stats stats() const noexcept
+    {
+        return counters_.load();
+    }
+
+    /** @return Counters of the calling thread queue */
+    producer_stats local_stats()
+    {
+        return local_thread_queue().stats.load();
+    }
+
+    /** Call f(const producer_stats&) for each thread queue, locks queue registration */
+    template< class F >
+    void for_each_thread_stats(F&& f)
+    {
+        std::lock_guard< std::mutex > lock{mutex_};
+        for (const auto& queue: queues_) {
+            f(queue->stats.load());
+        }
+    }
+
+    /** Wake up backend thread (required in futex mode only) */
+    LOGFW_FORCE_INLINE void notify() noexcept
+    {
+        if (options_.mode == wait_mode::futex) {
+            /* Pairs with fence in wait(), orders commit before the check */
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (LOGFW_UNLIKELY(sleeping_.load(std::memory_order_relaxed) != 0)) {
+                wake();
+            }
+        }
+    }
+
+    /**
+     * Consume available records.
+     * Should be called from a single thread, used by backend thread.
+     * @return Number of consumed records
+     */
+    std::size_t poll()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        if (LOGFW_UNLIKELY(now >= next_calibration_)) {
+            calibrate(now);
+        }
+
+        if (queues_changed_.load(std::memory_order_acquire)) {
+            update_queues();
+        }
+
+        lag_ = 0;
+        std::size_t count = 0;
+        for (auto& queue: active_queues_) {
+            count += consume(*queue);
+        }
+
+        if (count == 0) {
+            count = release_queues();
+        }
+
+        update_stats();
+        if (LOGFW_UNLIKELY(options_.stats_interval.count() > 0 && now >= next_stats_)) {
+            log_stats(now);
+        }
+
+        /* Idle flushes let sinks write delayed data (e.g. partial blocks) */
+        if (count > 0 || now >= next_flush_) {
+            next_flush_ = now + options_.idle_flush_interval;
+            for (auto& s: sinks_) {
+                s->flush();
+            }
+            for (auto& s: record_sinks_) {
+                s->flush();
+            }
+        }
+
+        return count;
+    }
+
+private:
+    static std::uint64_t next_id() noexcept
+    {
+        static std::atomic< std::uint64_t > counter{0};
+        return ++counter;
+    }
+
+    /* Queues of the calling thread, one per backend, the most recently used is first */
+    static std::vector< queue_ref >& local_refs() noexcept
+    {
+        static thread_local std::vector< queue_ref > refs;
+        return refs;
+    }
+
+    LOGFW_FORCE_INLINE thread_queue& local_thread_queue()
+    {
+        std::vector< queue_ref >& refs = local_refs();
+        if (LOGFW_LIKELY(!refs.empty() && refs.front().owner == id_)) {
+            return *refs.front().queue;
+        }
+        return local_queue_slow(refs);
+    }
+
+    thread_queue& local_queue_slow(std::vector< queue_ref >& refs)
+    {
+        /* Queues of destroyed backends are referenced only here */
+        refs.erase(std::remove_if(refs.begin(), refs.end(), [](const queue_ref& ref) {
+            return ref.queue.use_count() == 1;
+        }), refs.end());
+
+        auto found = std::find_if(refs.begin(), refs.end(), [this](const queue_ref& ref) {
+            return ref.owner == id_;
+        });
+        if (found == refs.end()) {
+            auto queue = std::make_shared< thread_queue >(options_.queue_capacity, options_.spill_chunk_size);
+            {
+                std::lock_guard< std::mutex > lock{mutex_};
+                queues_.push_back(queue);
+                queues_changed_.store(true, std::memory_order_release);
+            }
+            refs.push_back({id_, std::move(queue)});
+            found = refs.end() - 1;
+        }
+
+        std::rotate(refs.begin(), found, found + 1);
+        return *refs.front().queue;
+    }
+
+    LOGFW_FORCE_INLINE void enqueued(thread_queue& queue, std::size_t size) noexcept
+    {
+        queue.stats.records.add(1);
+        queue.stats.bytes.add(size);
+        notify();
+    }
+
+    /* Queue is full or there are spilled or dropped records */
+    template< class StringHolder, class... Args >
+    bool enqueue_overflow(thread_queue& queue, const Args&... args)
+    {
+        std::size_t retry = 0;
+        while (true) {
+            if (queue.flush()) {
+                const std::size_t size = logfw::enqueue_record< StringHolder >(queue.ring, args...);
+                if (size != 0) {
+                    enqueued(queue, size);
+                    return true;
+                }
+            }
+
+            switch (options_.overflow) {
+                case overflow_policy::drop:
+                    return drop(queue);
+
+                case overflow_policy::spin:
+                    if (retry++ >= options_.overflow_spin_count) {
+                        return drop(queue);
+                    }
+                    LOGFW_CPU_RELAX();
+                    break;
+
+                case overflow_policy::block:
+                    if (retry == 0 && record_bytes_required(args...) > queue.ring.max_frame_size()) {
+                        /* Never fits, would wait forever */
+                        return drop(queue);
+                    }
+                    notify();
+                    if (retry++ < options_.spin_count) {
+                        LOGFW_CPU_RELAX();
+                    } else {
+                        std::this_thread::yield();
+                    }
+                    break;
+
+                case overflow_policy::spill:
+                    enqueued(queue, logfw::enqueue_record< StringHolder >(queue.spill, args...));
+                    queue.stats.spilled.add(1);
+                    return true;
+            }
+        }
+    }
+
+    bool drop(thread_queue& queue) noexcept
+    {
+        ++queue.dropped;
+        queue.stats.dropped.add(1);
+        notify();
+        return false;
+    }
+
+    void calibrate(std::chrono::steady_clock::time_point now)
+    {
+        calibration_.update();
+        next_calibration_ = now + options_.calibration_interval;
+        for (auto& s: record_sinks_) {
+            s->calibrate(calibration_.params());
+        }
+    }
+
+    void update_queues()
+    {
+        std::lock_guard< std::mutex > lock{mutex_};
+        queues_changed_.store(false, std::memory_order_relaxed);
+        active_queues_ = queues_;
+    }
+
+    /**
+     * Drop queues of exited threads.
+     * @return Number of consumed records left in overflow state of exited threads
+     */
+    std::size_t release_queues()
+    {
+        auto is_orphaned = [](const std::shared_ptr< thread_queue >& queue) {
+            /* Referenced only by queues_ and active_queues_ */
+            return queue.use_count() == 2;
+        };
+
+        std::size_t count = 0;
+        for (auto& queue: active_queues_) {
+            if (is_orphaned(queue) && !queue->clean()) {
+                /* Producer has exited, backend takes over its overflow state */
+                std::atomic_thread_fence(std::memory_order_acquire);
+                while (!queue->flush()) {
+                    count += consume(*queue);
+                }
+                count += consume(*queue);
+            }
+        }
+        if (count > 0) {
+            return count;
+        }
+
+        const auto released = std::partition(active_queues_.begin(), active_queues_.end(),
+                [&is_orphaned](const std::shared_ptr< thread_queue >& queue) {
+                    return !is_orphaned(queue) || !queue->ring.empty();
+                });
+        if (released == active_queues_.end()) {
+            return 0;
+        }
+
+        std::for_each(released, active_queues_.end(), [this](const std::shared_ptr< thread_queue >& queue) {
+            const producer_stats stats = queue->stats.load();
+            retired_.records += stats.records;
+            retired_.bytes += stats.bytes;
+            retired_.dropped += stats.dropped;
+            retired_.spilled += stats.spilled;
+            retired_.high_water = std::max(retired_.high_water, stats.high_water);
+        });
+
+        std::lock_guard< std::mutex > lock{mutex_};
+        /* Queues registered after update_queues() are not released */
+        queues_.erase(std::remove_if(queues_.begin(), queues_.end(), [&](const std::shared_ptr< thread_queue >& queue) {
+            return std::find(released, active_queues_.end(), queue) != active_queues_.end();
+        }), queues_.end());
+        active_queues_ = queues_;
+        return 0;
+    }
+
+    /* Sum producer counters and publish them */
+    void update_stats() noexcept
+    {
+        producer_stats total = retired_;
+        for (const auto& queue: active_queues_) {
+            const producer_stats stats = queue->stats.load();
+            total.records += stats.records;
+            total.bytes += stats.bytes;
+            total.dropped += stats.dropped;
+            total.spilled += stats.spilled;
+            total.high_water = std::max(total.high_water, stats.high_water);
+        }
+        counters_.records.set(total.records);
+        counters_.bytes.set(total.bytes);
+        counters_.dropped.set(total.dropped);
+        counters_.spilled.set(total.spilled);
+        counters_.high_water.set(total.high_water);
+
+        const auto lag = static_cast< std::uint64_t >(double(lag_) * calibration_.params().ns_per_tick);
+        counters_.lag_ns.set(lag);
+        counters_.max_lag_ns.set_max(lag);
+    }
+
+    /* Enqueue stats record into the backend thread queue */
+    void log_stats(std::chrono::steady_clock::time_point now)
+    {
+        if (next_stats_ == std::chrono::steady_clock::time_point{}) {
+            /* First poll */
+            next_stats_ = now + options_.stats_interval;
+            return;
+        }
+        next_stats_ = now + options_.stats_interval;
+
+        if (!site_enabled< details::stats_site >()) {
+            return;
+        }
+
+        const backend_stats s = stats();
+        enqueue< details::stats_site >(s.records, s.bytes, s.dropped, s.spilled, s.high_water,
+                s.lag_ns, s.max_lag_ns,
+                s.formatted > 0 ? s.format_ns / s.formatted : std::uint64_t(0), s.max_format_ns,
+                s.sink_writes > 0 ? s.sink_ns / s.sink_writes : std::uint64_t(0), s.max_sink_ns);
+    }
+
+    static std::uint64_t elapsed_ns(std::chrono::steady_clock::time_point from,
+            std::chrono::steady_clock::time_point to) noexcept
+    {
+        return std::chrono::duration_cast< std::chrono::nanoseconds >(to - from).count();
+    }
+
+    /* @return Current time, or zero time point (nothing is measured) if timing is disabled */
+    LOGFW_FORCE_INLINE std::chrono::steady_clock::time_point timing_now() const noexcept
+    {
+        if (LOGFW_UNLIKELY(options_.timing)) {
+            return std::chrono::steady_clock::now();
+        }
+        return {};
+    }
+
+    void sink_written(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) noexcept
+    {
+        const std::uint64_t elapsed = elapsed_ns(from, to);
+        counters_.sink_writes.add(1);
+        counters_.sink_ns.add(elapsed);
+        counters_.max_sink_ns.set_max(elapsed);
+    }
+
+    std::size_t consume(thread_queue& queue)
+    {
+        spsc_ring& ring = queue.ring;
+        queue.stats.high_water.set_max(ring.size());
+
+        std::size_t count = 0;
+        record_header header;
+        while (count < options_.batch_size) {
+            const char* payload = front_record(ring, header);
+            if (!payload) {
+                break;
+            }
+            if (count == 0) {
+                /* Timestamps of other threads might be slightly ahead */
+                const std::uint64_t now = record_clock::now();
+                if (now > header.timestamp) {
+                    lag_ = std::max(lag_, now - header.timestamp);
+                }
+            }
+            if (!record_sinks_.empty()) {
+                const auto start = timing_now();
+                for (auto& s: record_sinks_) {
+                    s->write(header, payload);
+                }
+                sink_written(start, timing_now());
+            }
+            if (!sinks_.empty()) {
+                render(header, payload);
+            }
+            ring.pop();
+            ++count;
+        }
+        return count;
+    }
+
+    void render(const record_header& header, const char* payload)
+    {
+        const auto start = timing_now();
+        buffer_.clear();
+
+        if (LOGFW_CLOCK != LOGFW_CLOCK_NONE && options_.timestamps) {
+            timestamp_.format(buffer_, calibration_.to_realtime(header.timestamp));
+            buffer_.push_back(' ');
+        }
+
+        try {
+            const format_info* info = format_registry::instance().find(header.format);
+            if (LOGFW_UNLIKELY(!info)) {
+                throw std::runtime_error("Unknown format id");
+            }
+            if (LOGFW_LIKELY(info->ops)) {
+                /* Format parsed at compile time */
+                details::run_format_ops< record_encoding >(buffer_, info->format.data(), info->ops, info->ops_count,
+                        payload, header.size);
+            } else {
+                programs_.get(header.format, info->format).run< record_encoding >(buffer_, payload, header.size);
+            }
+        } catch (const std::exception& e) {
+            buffer_.append("<format error: ");
+            buffer_.append(e.what());
+            buffer_.push_back('>');
+        }
+        buffer_.push_back('\n');
+
+        const auto formatted = timing_now();
+        const std::uint64_t elapsed = elapsed_ns(start, formatted);
+        counters_.formatted.add(1);
+        counters_.format_ns.add(elapsed);
+        counters_.max_format_ns.set_max(elapsed);
+
+        for (auto& s: sinks_) {
+            s->write(buffer_.str());
+        }
+        sink_written(formatted, timing_now());
+    }
+
+    void wake() noexcept
+    {
+        sleeping_.store(0, std::memory_order_relaxed);
+        details::futex_wake(sleeping_);
+    }
+
+    void wait(std::size_t idle)
+    {
+        switch (options_.mode) {
+            case wait_mode::busy_poll:
+                break;
+
+            case wait_mode::adaptive:
+                if (idle >= options_.spin_count) {
+                    std::this_thread::sleep_for(options_.sleep_duration);
+                }
+                break;
+
+            case wait_mode::futex:
+                if (idle >= options_.spin_count) {
+                    sleeping_.store(1, std::memory_order_relaxed);
+                    /* Pairs with fence in notify() */
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    if (all_empty() && running_.load(std::memory_order_relaxed)) {
+                        details::futex_wait(sleeping_, 1, options_.sleep_duration);
+                    }
+                    sleeping_.store(0, std::memory_order_relaxed);
+                }
+                break;
+        }
+    }
+
+    bool all_empty() const noexcept
+    {
+        return std::all_of(active_queues_.begin(), active_queues_.end(), [](const auto& queue) {
+            return queue->ring.empty();
+        }) && !queues_changed_.load(std::memory_order_relaxed);
+    }
+
+    void run()
+    {
+        std::size_t idle = 0;
+        while (running_.load(std::memory_order_relaxed)) {
+            if (poll() > 0) {
+                idle = 0;
+            } else {
+                wait(++idle);
+            }
+        }
+
+        /* Drain pending records */
+        while (poll() > 0)
+        {}
+    }
+};
+
+} /* namespace logfw */
+
+#endif /* KSERGEY_backend_031018113410 */
@@ -0,0 +1,281 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_binary_format_091018103317
+#define KSERGEY_binary_format_091018103317
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+
+#include "buffer.hpp"
+#include "clock.hpp"
+#include "compiler.hpp"
+#include "format_registry.hpp"
+#include "record.hpp"
+
+/*
+ * Binary log file format.
+ *
+ * layout: [file_header][dictionary-entry]...[frame]...
+ *
+ * Each frame is a record: [record_header][encoded-args], or a dictionary
+ * entry for a format registered after the file was started:
+ * [record_header{dictionary_frame, entry size}][dictionary-entry],
+ * or a clock calibration for timestamps of the following records:
+ * [record_header{calibration_frame, sizeof(clock_params)}][clock_params].
+ *
+ * Preallocated files (see rotating_file_sink) might end with
+ * [record_header{end_frame, 0}] followed by unused space.
+ *
+ * Compressed file (flag_compressed) stores everything after the file header
+ * in blocks: [block_header][LZ compressed bytes (see details/lz.hpp)].
+ * Block with stored_size equal to raw_size is not compressed. Frames might
+ * span blocks.
+ *
+ * Dictionary entry: [dictionary_entry][format][file][function]
+ *
+ * All numbers are in the byte order of the producer, which is recorded
+ * in the file header.
+ */
+
+namespace logfw::binary {
+
+/* File magic */
+static constexpr const char magic[8] = {'L', 'O', 'G', 'F', 'W', 'B', 'I', 'N'};
+
+/* Current format version */
+static constexpr std::uint16_t version = 4;
+
+/* Written as number, reads back the same only with the same byte order */
+static constexpr std::uint32_t byte_order_mark = 0x01020304;
+
+/* Format id of a frame with dictionary entry */
+static constexpr std::uint32_t dictionary_frame = std::numeric_limits< std::uint32_t >::max();
+
+/* Format id of a frame with clock calibration */
+static constexpr std::uint32_t calibration_frame = dictionary_frame - 1;
+
+/* Format id of a frame which marks the end of written data */
+static constexpr std::uint32_t end_frame = dictionary_frame - 2;
+
+/* File flag: record args are encoded with compact_encoding */
+static constexpr std::uint32_t flag_compact_encoding = 0x1;
+
+/* File flag: data after the file header is stored in compressed blocks */
+static constexpr std::uint32_t flag_compressed = 0x2;
+
+/* Max uncompressed block size */
+static constexpr std::uint32_t max_block_size = 64 * 1024 * 1024;
+
+/** File header */
+struct file_header
+{
+    char magic[8];
+    std::uint16_t version;
+    /* sizeof(void*) of the producer */
+    std::uint8_t pointer_size;
+    /* sizeof(record_header) of the producer */
+    std::uint8_t record_header_size;
+    std::uint32_t byte_order;
+    /* Flags (flag_*) */
+    std::uint32_t flags;
+    /* Number of dictionary entries after the header */
+    std::uint32_t format_count;
+    /* Timestamp source of records (LOGFW_CLOCK) */
+    std::uint32_t clock;
+};
+
+/** Compressed file block header */
+struct block_header
+{
+    /* Uncompressed size */
+    std::uint32_t raw_size;
+    /* Size of the block data */
+    std::uint32_t stored_size;
+};
+
+/** Dictionary entry header */
+struct dictionary_entry
+{
+    std::uint32_t id;
+    std::uint32_t line;
+    std::uint32_t format_size;
+    std::uint32_t file_size;
+    std::uint32_t function_size;
+};
+
+/**
+ * Binary stream serializer.
+ *
+ * Appends file header, dictionary and records to a buffer. Formats
+ * registered after begin() are emitted as dictionary frames before the
+ * next record.
+ *
+ * Output is buffer or anything with the same prepare/commit/append interface.
+ */
+class stream_writer
+{
+private:
+    /* Number of formats written to the stream */
+    std::uint32_t format_count_{0};
+
+public:
+    /**
+     * Append file header and dictionary of all registered formats.
+     * @param[in] flags are additional file flags (e.g. flag_compressed)
+     */
+    template< class Output >
+    void begin(Output& buf, std::uint32_t flags = 0)
+    {
+        begin(buf, flags, format_registry::instance().size());
+    }
+
+    /**
+     * Append file header and dictionary of first count formats.
+     * @param[in] count is registry size taken for begin_size(count)
+     */
+    template< class Output >
+    void begin(Output& buf, std::uint32_t flags, std::uint32_t count)
+    {
+        const format_registry& registry = format_registry::instance();
+
+        file_header header;
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.pointer_size = sizeof(void*);
+        header.record_header_size = sizeof(record_header);
+        header.byte_order = byte_order_mark;
+        header.flags = flags | (record_encoding_id == LOGFW_ENCODING_COMPACT ? flag_compact_encoding : 0);
+        header.format_count = count;
+        header.clock = record_clock_id;
+        buf.append(reinterpret_cast< const char* >(&header), sizeof(header));
+
+        for (std::uint32_t id = 0; id < header.format_count; ++id) {
+            append_entry(buf, id, *registry.find(id));
+        }
+        format_count_ = header.format_count;
+    }
+
+    /** @return Size of file header and dictionary of first count formats */
+    static std::size_t begin_size(std::uint32_t count) noexcept
+    {
+        const format_registry& registry = format_registry::instance();
+
+        std::size_t size = sizeof(file_header);
+        for (std::uint32_t id = 0; id < count; ++id) {
+            size += entry_size(*registry.find(id));
+        }
+        return size;
+    }
+
+    /**
+     * @return Size of record with dictionary frames to be written before it
+     * @param[in] count is registry size, the same value should be passed to write()
+     *      since other threads could register formats in between
+     */
+    std::size_t bytes_required(const record_header& header, std::uint32_t count) const noexcept
+    {
+        std::size_t size = sizeof(header) + header.size;
+
+        const format_registry& registry = format_registry::instance();
+        for (std::uint32_t id = format_count_; id < count; ++id) {
+            const format_info* info = registry.find(id);
+            if (LOGFW_UNLIKELY(!info)) {
+                break;
+            }
+            size += sizeof(record_header) + entry_size(*info);
+        }
+        return size;
+    }
+
+    /** Append record */
+    template< class Output >
+    LOGFW_FORCE_INLINE void write(Output& buf, const record_header& header, const char* payload)
+    {
+        write(buf, header, payload, format_registry::instance().size());
+    }
+
+    /**
+     * Append record, dictionary frames are written for formats up to count.
+     * @param[in] count is registry size passed to bytes_required()
+     */
+    template< class Output >
+    LOGFW_FORCE_INLINE void write(Output& buf, const record_header& header, const char* payload, std::uint32_t count)
+    {
+        /* Record might refer to later registered format or literal */
+        if (LOGFW_UNLIKELY(format_count_ < count)) {
+            update_dictionary(buf, count);
+        }
+
+        char* data = buf.prepare(sizeof(header) + header.size);
+        std::memcpy(data, &header, sizeof(header));
+        std::memcpy(data + sizeof(header), payload, header.size);
+        buf.commit(sizeof(header) + header.size);
+    }
+
+    /** Size of clock calibration frame */
+    static constexpr std::size_t calibration_size = sizeof(record_header) + sizeof(clock_params);
+
+    /** Append clock calibration for the following records */
+    template< class Output >
+    void calibrate(Output& buf, const clock_params& params)
+    {
+        record_header header;
+        header.format = calibration_frame;
+        header.size = sizeof(params);
+        header.timestamp = params.ticks;
+        buf.append(reinterpret_cast< const char* >(&header), sizeof(header));
+        buf.append(reinterpret_cast< const char* >(&params), sizeof(params));
+    }
+
+private:
+    static std::size_t entry_size(const format_info& info) noexcept
+    {
+        return sizeof(dictionary_entry) + info.format.size() + info.file.size() + info.function.size();
+    }
+
+    template< class Output >
+    static void append_entry(Output& buf, std::uint32_t id, const format_info& info)
+    {
+        dictionary_entry entry;
+        entry.id = id;
+        entry.line = info.line;
+        entry.format_size = static_cast< std::uint32_t >(info.format.size());
+        entry.file_size = static_cast< std::uint32_t >(info.file.size());
+        entry.function_size = static_cast< std::uint32_t >(info.function.size());
+        buf.append(reinterpret_cast< const char* >(&entry), sizeof(entry));
+        /* Internal sites have no file and function (null data) */
+        for (std::string_view str: {info.format, info.file, info.function}) {
+            if (!str.empty()) {
+                buf.append(str);
+            }
+        }
+    }
+
+    template< class Output >
+    void update_dictionary(Output& buf, std::uint32_t count)
+    {
+        const format_registry& registry = format_registry::instance();
+
+        for (; format_count_ < count; ++format_count_) {
+            const format_info* info = registry.find(format_count_);
+            if (LOGFW_UNLIKELY(!info)) {
+                break;
+            }
+
+            record_header header;
+            header.format = dictionary_frame;
+            header.timestamp = 0;
+            header.size = static_cast< std::uint32_t >(entry_size(*info));
+            buf.append(reinterpret_cast< const char* >(&header), sizeof(header));
+            append_entry(buf, format_count_, *info);
+        }
+    }
+};
+
+} // namespace logfw::binary
+
+#endif /* KSERGEY_binary_format_091018103317 */
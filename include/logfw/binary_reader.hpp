@@ -0,0 +1,345 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_binary_reader_091018141108
+#define KSERGEY_binary_reader_091018141108
+
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "binary_format.hpp"
+#include "clock.hpp"
+#include "compiler.hpp"
+#include "format_registry.hpp"
+#include "record.hpp"
+#include "details/lz.hpp"
+
+namespace logfw::binary {
+
+/**
+ * Binary log file reader.
+ *
+ * File is mapped into memory, records are returned in place. Compressed
+ * files are decompressed block by block while reading.
+ */
+class file_reader
+{
+private:
+    int fd_{-1};
+    const char* data_{nullptr};
+    std::size_t size_{0};
+    /* Position of the next block in compressed file */
+    std::size_t block_pos_{0};
+
+    /* Frames: file content after the header or decompressed blocks */
+    const char* stream_{nullptr};
+    std::size_t stream_size_{0};
+    std::size_t pos_{0};
+    std::vector< char > block_;
+
+    file_header header_;
+    std::vector< format_info > dictionary_;
+    /* Dictionary strings */
+    std::deque< std::string > strings_;
+    clock_params clock_{0, 0, 1.0};
+    bool calibrated_{false};
+    bool truncated_{false};
+
+public:
+    /**
+     * Open file.
+     * @throw std::runtime_error on i/o error or unsupported file
+     */
+    explicit file_reader(const std::string& path)
+    {
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) {
+            throw std::runtime_error("Failed to open \"" + path + "\": " + std::strerror(errno));
+        }
+
+        struct stat st;
+        if (::fstat(fd_, &st) < 0) {
+            close();
+            throw std::runtime_error("Failed to stat \"" + path + "\": " + std::strerror(errno));
+        }
+        size_ = st.st_size;
+
+        if (size_ > 0) {
+            void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+            if (data == MAP_FAILED) {
+                close();
+                throw std::runtime_error("Failed to map \"" + path + "\": " + std::strerror(errno));
+            }
+            data_ = static_cast< const char* >(data);
+            ::madvise(data, size_, MADV_SEQUENTIAL);
+        }
+
+        try {
+            read_header();
+        } catch (...) {
+            close();
+            throw;
+        }
+    }
+
+    file_reader(const file_reader&) = delete;
+    file_reader& operator=(const file_reader&) = delete;
+
+    ~file_reader()
+    {
+        close();
+    }
+
+    /** @return File header */
+    const file_header& header() const noexcept
+    {
+        return header_;
+    }
+
+    /** @return Format by id or nullptr if id is unknown */
+    const format_info* find(std::uint32_t id) const noexcept
+    {
+        if (LOGFW_UNLIKELY(id >= dictionary_.size() || dictionary_[id].format.data() == nullptr)) {
+            return nullptr;
+        }
+        return &dictionary_[id];
+    }
+
+    /** @return Encoding of record args (LOGFW_ENCODING) */
+    std::uint32_t encoding() const noexcept
+    {
+        return (header_.flags & flag_compact_encoding) ? LOGFW_ENCODING_COMPACT : LOGFW_ENCODING_FIXED;
+    }
+
+    /** @return true if record timestamps could be converted to wall-clock time */
+    bool calibrated() const noexcept
+    {
+        return calibrated_;
+    }
+
+    /** @return CLOCK_REALTIME nanoseconds of record timestamp (last calibration is used) */
+    std::int64_t to_realtime(std::uint64_t timestamp) const noexcept
+    {
+        return logfw::to_realtime(clock_, timestamp);
+    }
+
+    /** @return true if the file is stored in compressed blocks */
+    bool compressed() const noexcept
+    {
+        return header_.flags & flag_compressed;
+    }
+
+    /**
+     * Read next record.
+     * @param[out] header is record header
+     * @param[out] payload is pointer to encoded args, valid until the next call
+     * @return false at the end of file
+     * @throw std::runtime_error on corrupted file
+     */
+    bool next(record_header& header, const char*& payload)
+    {
+        while (true) {
+            if (!available(sizeof(header))) {
+                return false;
+            }
+
+            std::memcpy(&header, stream_ + pos_, sizeof(header));
+            if (LOGFW_UNLIKELY(header.format == end_frame)) {
+                /* The rest of preallocated file is unused */
+                return false;
+            }
+            if (LOGFW_UNLIKELY(!available(sizeof(header) + header.size))) {
+                /* Last record was not completely written */
+                return false;
+            }
+
+            payload = stream_ + pos_ + sizeof(header);
+            pos_ += sizeof(header) + header.size;
+
+            if (LOGFW_UNLIKELY(header.format == dictionary_frame)) {
+                if (read_entry(payload, header.size) != header.size) {
+                    throw std::runtime_error("Corrupted dictionary");
+                }
+                continue;
+            }
+
+            if (LOGFW_UNLIKELY(header.format == calibration_frame)) {
+                if (header.size != sizeof(clock_)) {
+                    throw std::runtime_error("Corrupted calibration");
+                }
+                std::memcpy(&clock_, payload, sizeof(clock_));
+                calibrated_ = header_.clock != LOGFW_CLOCK_NONE;
+                continue;
+            }
+
+            return true;
+        }
+    }
+
+    /** @return true if the file ends with incomplete record */
+    bool truncated() const noexcept
+    {
+        return truncated_;
+    }
+
+private:
+    void close() noexcept
+    {
+        if (data_) {
+            ::munmap(const_cast< char* >(data_), size_);
+            data_ = nullptr;
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    void read_header()
+    {
+        if (size_ < sizeof(header_)) {
+            throw std::runtime_error("Not a binary log file (too small)");
+        }
+
+        std::memcpy(&header_, data_, sizeof(header_));
+        if (std::memcmp(header_.magic, magic, sizeof(magic)) != 0) {
+            throw std::runtime_error("Not a binary log file (bad magic)");
+        }
+        if (header_.version != version) {
+            throw std::runtime_error("Unsupported binary log version");
+        }
+        if (header_.byte_order != byte_order_mark) {
+            throw std::runtime_error("Unsupported byte order");
+        }
+        if (header_.pointer_size != sizeof(void*) || header_.record_header_size != sizeof(record_header)) {
+            throw std::runtime_error("Unsupported ABI");
+        }
+
+        if (compressed()) {
+            block_pos_ = sizeof(header_);
+        } else {
+            stream_ = data_ + sizeof(header_);
+            stream_size_ = size_ - sizeof(header_);
+        }
+
+        for (std::uint32_t i = 0; i < header_.format_count; ++i) {
+            dictionary_entry entry;
+            if (!available(sizeof(entry))) {
+                throw std::runtime_error("Corrupted dictionary");
+            }
+            std::memcpy(&entry, stream_ + pos_, sizeof(entry));
+            const std::size_t size = sizeof(entry) + std::size_t(entry.format_size) + entry.file_size + entry.function_size;
+            if (!available(size)) {
+                throw std::runtime_error("Corrupted dictionary");
+            }
+            pos_ += read_entry(stream_ + pos_, size);
+        }
+    }
+
+    /**
+     * Make size bytes at the current position available, loads blocks of compressed file.
+     * @return false if the file ends earlier
+     */
+    LOGFW_FORCE_INLINE bool available(std::size_t size)
+    {
+        while (LOGFW_UNLIKELY(stream_size_ - pos_ < size)) {
+            if (!load_block()) {
+                truncated_ = truncated_ || pos_ != stream_size_;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /* Decompress next block after unread data */
+    bool load_block()
+    {
+        if (!compressed()) {
+            return false;
+        }
+
+        block_header block;
+        if (block_pos_ + sizeof(block) > size_) {
+            /* Incomplete block header */
+            truncated_ = block_pos_ != size_;
+            return false;
+        }
+        std::memcpy(&block, data_ + block_pos_, sizeof(block));
+        if (block.raw_size > max_block_size || block.stored_size > block.raw_size) {
+            throw std::runtime_error("Corrupted block");
+        }
+        if (block_pos_ + sizeof(block) + block.stored_size > size_) {
+            /* Last block was not completely written */
+            truncated_ = true;
+            return false;
+        }
+        const char* stored = data_ + block_pos_ + sizeof(block);
+        block_pos_ += sizeof(block) + block.stored_size;
+
+        /* Keep unread data in front of the block */
+        const std::size_t unread = stream_size_ - pos_;
+        std::vector< char > next(unread + block.raw_size);
+        if (unread > 0) {
+            std::memcpy(next.data(), stream_ + pos_, unread);
+        }
+        if (block.stored_size == block.raw_size) {
+            std::memcpy(next.data() + unread, stored, block.raw_size);
+        } else if (!details::lz_decompress(stored, block.stored_size, next.data() + unread, block.raw_size)) {
+            throw std::runtime_error("Corrupted block");
+        }
+
+        block_.swap(next);
+        stream_ = block_.data();
+        stream_size_ = block_.size();
+        pos_ = 0;
+        return true;
+    }
+
+    /**
+     * Read dictionary entry of size bytes, strings are copied.
+     * @return Entry size
+     */
+    std::size_t read_entry(const char* data, std::size_t size)
+    {
+        dictionary_entry entry;
+        if (size < sizeof(entry)) {
+            throw std::runtime_error("Corrupted dictionary");
+        }
+        std::memcpy(&entry, data, sizeof(entry));
+
+        const std::size_t strings = std::size_t(entry.format_size) + entry.file_size + entry.function_size;
+        if (sizeof(entry) + strings > size) {
+            throw std::runtime_error("Corrupted dictionary");
+        }
+        const std::string& value = strings_.emplace_back(data + sizeof(entry), strings);
+
+        format_info info;
+        info.format = {value.data(), entry.format_size};
+        info.file = {value.data() + entry.format_size, entry.file_size};
+        info.function = {value.data() + entry.format_size + entry.file_size, entry.function_size};
+        info.line = entry.line;
+
+        /* Ids are assigned in order, bound id before allocation */
+        if (entry.id > dictionary_.size()) {
+            throw std::runtime_error("Corrupted dictionary");
+        }
+        if (entry.id == dictionary_.size()) {
+            dictionary_.emplace_back();
+        }
+        dictionary_[entry.id] = info;
+        return sizeof(entry) + strings;
+    }
+};
+
+} // namespace logfw::binary
+
+#endif /* KSERGEY_binary_reader_091018141108 */
@@ -0,0 +1,182 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_binary_sink_091018120245
+#define KSERGEY_binary_sink_091018120245
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "binary_format.hpp"
+#include "buffer.hpp"
+#include "sink.hpp"
+#include "details/lz.hpp"
+
+namespace logfw {
+
+/** Binary file sink settings */
+struct binary_file_sink_options
+{
+    /* Store records in compressed blocks (see binary::flag_compressed) */
+    bool compress = false;
+    /* Uncompressed block size in bytes */
+    std::size_t block_size = 256 * 1024;
+    /* Max time records are kept in a partial block */
+    std::chrono::milliseconds max_delay{1000};
+};
+
+/**
+ * Binary log file sink.
+ * Records are stored encoded, see binary_format.hpp and logfw-decode tool.
+ *
+ * With compression enabled records are written once a full block is
+ * collected, or after max_delay as a partial block. Delay is checked on
+ * flush(), which backend also calls while idle, so it should be greater
+ * than backend_options::idle_flush_interval.
+ */
+class binary_file_sink final
+    : public record_sink
+{
+private:
+    int fd_{-1};
+    binary_file_sink_options options_;
+    buffer buffer_;
+    binary::stream_writer writer_;
+
+    /* Compression state */
+    std::unique_ptr< details::lz_compressor > compressor_;
+    std::unique_ptr< char[] > block_;
+    /* Time of the oldest data in a partial block */
+    std::chrono::steady_clock::time_point pending_since_{};
+
+public:
+    /**
+     * Create file.
+     * @throw std::runtime_error on i/o error
+     */
+    explicit binary_file_sink(const std::string& path, binary_file_sink_options options = {})
+        : options_(options)
+    {
+        if (options_.compress && (options_.block_size == 0 || options_.block_size > binary::max_block_size)) {
+            throw std::invalid_argument("Invalid binary file block size");
+        }
+
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::runtime_error("Failed to open \"" + path + "\": " + std::strerror(errno));
+        }
+
+        if (options_.compress) {
+            compressor_ = std::make_unique< details::lz_compressor >();
+            block_.reset(new char[sizeof(binary::block_header) + details::lz_bound(options_.block_size)]);
+
+            writer_.begin(buffer_, binary::flag_compressed);
+            /* File header is not compressed */
+            write_all(buffer_.data(), sizeof(binary::file_header));
+            buffer_.consume(sizeof(binary::file_header));
+        } else {
+            writer_.begin(buffer_);
+        }
+        flush();
+    }
+
+    ~binary_file_sink() override
+    {
+        write_buffer(true);
+        ::close(fd_);
+    }
+
+    void write(const record_header& header, const char* payload) override
+    {
+        writer_.write(buffer_, header, payload);
+    }
+
+    void calibrate(const clock_params& params) override
+    {
+        writer_.calibrate(buffer_, params);
+    }
+
+    void flush() override
+    {
+        write_buffer(false);
+    }
+
+private:
+    /* Write buffered data, partial block is kept unless forced or too old */
+    void write_buffer(bool force)
+    {
+        if (!compressor_) {
+            write_all(buffer_.data(), buffer_.size());
+            buffer_.clear();
+            return;
+        }
+
+        std::size_t offset = 0;
+        while (buffer_.size() - offset >= options_.block_size) {
+            write_block(buffer_.data() + offset, options_.block_size);
+            offset += options_.block_size;
+        }
+
+        if (offset < buffer_.size()) {
+            const auto now = std::chrono::steady_clock::now();
+            if (offset > 0 || pending_since_ == std::chrono::steady_clock::time_point{}) {
+                pending_since_ = now;
+            }
+            if (force || now - pending_since_ >= options_.max_delay) {
+                write_block(buffer_.data() + offset, buffer_.size() - offset);
+                offset = buffer_.size();
+            }
+        }
+        if (offset == buffer_.size()) {
+            pending_since_ = {};
+        }
+
+        buffer_.consume(offset);
+    }
+
+    void write_block(const char* data, std::size_t size)
+    {
+        char* out = block_.get() + sizeof(binary::block_header);
+        std::size_t stored = compressor_->compress(data, size, out);
+        if (stored >= size) {
+            /* Incompressible */
+            std::memcpy(out, data, size);
+            stored = size;
+        }
+
+        binary::block_header header;
+        header.raw_size = static_cast< std::uint32_t >(size);
+        header.stored_size = static_cast< std::uint32_t >(stored);
+        std::memcpy(block_.get(), &header, sizeof(header));
+
+        write_all(block_.get(), sizeof(header) + stored);
+    }
+
+    void write_all(const char* data, std::size_t size) noexcept
+    {
+        while (size > 0) {
+            const ssize_t rc = ::write(fd_, data, size);
+            if (rc < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                /* Nowhere to report, drop data */
+                break;
+            }
+            data += rc;
+            size -= rc;
+        }
+    }
+};
+
+} /* namespace logfw */
+
+#endif /* KSERGEY_binary_sink_091018120245 */
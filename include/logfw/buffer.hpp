@@ -0,0 +1,138 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_buffer_081018160512
+#define KSERGEY_buffer_081018160512
+
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+#include "compiler.hpp"
+
+namespace logfw {
+
+/** Growable contiguous char buffer */
+class buffer
+{
+private:
+    std::unique_ptr< char[] > data_;
+    std::size_t size_{0};
+    std::size_t capacity_{0};
+
+public:
+    explicit buffer(std::size_t capacity = 4096)
+        : data_(new char[capacity])
+        , capacity_(capacity)
+    {}
+
+    buffer(buffer&&) noexcept = default;
+    buffer& operator=(buffer&&) noexcept = default;
+
+    /** @return Pointer to buffer content */
+    const char* data() const noexcept
+    {
+        return data_.get();
+    }
+
+    /** @return Content size */
+    std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    /** @return Allocated size */
+    std::size_t capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+    /** @return true if buffer is empty */
+    bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+    /** @return Buffer content */
+    std::string_view str() const noexcept
+    {
+        return {data_.get(), size_};
+    }
+
+    /** Drop content, keep allocated memory */
+    void clear() noexcept
+    {
+        size_ = 0;
+    }
+
+    /** Drop size bytes from the beginning of content */
+    void consume(std::size_t size) noexcept
+    {
+        std::memmove(data_.get(), data_.get() + size, size_ - size);
+        size_ -= size;
+    }
+
+    /**
+     * Get space for at least size bytes at the end of content.
+     * Space becomes a part of content after commit().
+     */
+    LOGFW_FORCE_INLINE char* prepare(std::size_t size)
+    {
+        if (LOGFW_UNLIKELY(size_ + size > capacity_)) {
+            grow(size_ + size);
+        }
+        return data_.get() + size_;
+    }
+
+    /** Append size bytes of prepared space to content */
+    LOGFW_FORCE_INLINE void commit(std::size_t size) noexcept
+    {
+        size_ += size;
+    }
+
+    /** Append chars */
+    LOGFW_FORCE_INLINE void append(const char* str, std::size_t size)
+    {
+        std::memcpy(prepare(size), str, size);
+        size_ += size;
+    }
+
+    /** Append string */
+    LOGFW_FORCE_INLINE void append(std::string_view str)
+    {
+        append(str.data(), str.size());
+    }
+
+    /** Append count copies of char */
+    LOGFW_FORCE_INLINE void append(std::size_t count, char ch)
+    {
+        std::memset(prepare(count), ch, count);
+        size_ += count;
+    }
+
+    /** Append char */
+    LOGFW_FORCE_INLINE void push_back(char ch)
+    {
+        *prepare(1) = ch;
+        ++size_;
+    }
+
+private:
+    void grow(std::size_t size)
+    {
+        std::size_t capacity = capacity_ > 0 ? capacity_ * 2 : 64;
+        while (capacity < size) {
+            capacity *= 2;
+        }
+
+        std::unique_ptr< char[] > data{new char[capacity]};
+        std::memcpy(data.get(), data_.get(), size_);
+        data_ = std::move(data);
+        capacity_ = capacity;
+    }
+};
+
+} /* namespace logfw */
+
+#endif /* KSERGEY_buffer_081018160512 */
@@ -0,0 +1,233 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_clock_111018094217
+#define KSERGEY_clock_111018094217
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <thread>
+
+#include "buffer.hpp"
+#include "compiler.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#   include <x86intrin.h>
+#endif
+
+/* Record timestamp sources */
+#define LOGFW_CLOCK_NONE 0
+#define LOGFW_CLOCK_TSC 1
+#define LOGFW_CLOCK_STEADY 2
+
+/* Compile-time choice of record timestamp source */
+#ifndef LOGFW_CLOCK
+#   if defined(__x86_64__) || defined(__i386__)
+#       define LOGFW_CLOCK LOGFW_CLOCK_TSC
+#   else
+#       define LOGFW_CLOCK LOGFW_CLOCK_STEADY
+#   endif
+#endif
+
+namespace logfw {
+
+/** Time stamp counter, requires invariant TSC */
+struct tsc_clock
+{
+    /* Ticks have to be calibrated against CLOCK_REALTIME */
+    static constexpr bool calibrated = true;
+
+    static LOGFW_FORCE_INLINE std::uint64_t now() noexcept
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        /* rdtscp waits for prior instructions, not required for logging */
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+};
+
+/** std::chrono::steady_clock, ticks are nanoseconds */
+struct steady_clock
+{
+    static constexpr bool calibrated = false;
+
+    static LOGFW_FORCE_INLINE std::uint64_t now() noexcept
+    {
+        return std::chrono::duration_cast< std::chrono::nanoseconds >(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+/** No timestamps */
+struct null_clock
+{
+    static constexpr bool calibrated = false;
+
+    static LOGFW_FORCE_INLINE std::uint64_t now() noexcept
+    {
+        return 0;
+    }
+};
+
+#if LOGFW_CLOCK == LOGFW_CLOCK_TSC
+using record_clock = tsc_clock;
+#elif LOGFW_CLOCK == LOGFW_CLOCK_STEADY
+using record_clock = steady_clock;
+#elif LOGFW_CLOCK == LOGFW_CLOCK_NONE
+using record_clock = null_clock;
+#else
+#   error "Unknown LOGFW_CLOCK"
+#endif
+
+/** Record timestamp source id (stored in binary logs) */
+static constexpr std::uint32_t record_clock_id = LOGFW_CLOCK;
+
+/** Mapping of clock ticks to wall-clock time */
+struct clock_params
+{
+    /* Ticks at calibration point */
+    std::uint64_t ticks;
+    /* CLOCK_REALTIME nanoseconds at calibration point */
+    std::int64_t realtime;
+    /* Nanoseconds per tick */
+    double ns_per_tick;
+};
+
+/** @return CLOCK_REALTIME nanoseconds of ticks */
+LOGFW_FORCE_INLINE std::int64_t to_realtime(const clock_params& params, std::uint64_t ticks) noexcept
+{
+    /* Ticks might be taken before calibration point */
+    const auto delta = static_cast< std::int64_t >(ticks - params.ticks);
+    return params.realtime + static_cast< std::int64_t >(delta * params.ns_per_tick);
+}
+
+/**
+ * Calibration of record_clock against CLOCK_REALTIME.
+ *
+ * Frequency is measured from the first sample, so precision grows
+ * with each update().
+ */
+class clock_calibration
+{
+private:
+    clock_params base_;
+    clock_params params_;
+
+public:
+    clock_calibration()
+    {
+        base_ = sample();
+        if constexpr (record_clock::calibrated) {
+            /* Initial frequency estimation */
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        update();
+    }
+
+    /** Take new calibration point */
+    void update() noexcept
+    {
+        clock_params params = sample();
+        if constexpr (record_clock::calibrated) {
+            if (params.ticks > base_.ticks && params.realtime > base_.realtime) {
+                params.ns_per_tick = double(params.realtime - base_.realtime) / double(params.ticks - base_.ticks);
+            } else {
+                /* Wall-clock went backward */
+                params.ns_per_tick = params_.ns_per_tick;
+                base_ = params;
+            }
+        }
+        params_ = params;
+    }
+
+    /** @return Current calibration */
+    const clock_params& params() const noexcept
+    {
+        return params_;
+    }
+
+    /** @return CLOCK_REALTIME nanoseconds of ticks */
+    std::int64_t to_realtime(std::uint64_t ticks) const noexcept
+    {
+        return logfw::to_realtime(params_, ticks);
+    }
+
+private:
+    static std::int64_t realtime() noexcept
+    {
+        struct timespec ts;
+        ::clock_gettime(CLOCK_REALTIME, &ts);
+        return std::int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    /* Read both clocks, the pair with the shortest read interval wins */
+    static clock_params sample() noexcept
+    {
+        clock_params result{0, 0, 1.0};
+        std::uint64_t best = std::numeric_limits< std::uint64_t >::max();
+
+        for (int i = 0; i < 5; ++i) {
+            const std::uint64_t before = record_clock::now();
+            const std::int64_t now = realtime();
+            const std::uint64_t after = record_clock::now();
+
+            if (after - before < best) {
+                best = after - before;
+                result.ticks = before + (after - before) / 2;
+                result.realtime = now;
+            }
+        }
+
+        return result;
+    }
+};
+
+/**
+ * Wall-clock time formatter, "YYYY-MM-DD HH:MM:SS.nnnnnnnnn" (UTC).
+ * Date and time part is cached for the current second.
+ */
+class timestamp_formatter
+{
+private:
+    std::int64_t second_{std::numeric_limits< std::int64_t >::min()};
+    char prefix_[20];
+
+public:
+    void format(buffer& buf, std::int64_t realtime)
+    {
+        std::int64_t second = realtime / 1000000000;
+        std::int64_t nanos = realtime % 1000000000;
+        if (nanos < 0) {
+            second -= 1;
+            nanos += 1000000000;
+        }
+
+        if (LOGFW_UNLIKELY(second != second_)) {
+            const std::time_t t = static_cast< std::time_t >(second);
+            struct tm tm;
+            ::gmtime_r(&t, &tm);
+            std::strftime(prefix_, sizeof(prefix_), "%Y-%m-%d %H:%M:%S", &tm);
+            second_ = second;
+        }
+
+        char* ptr = buf.prepare(sizeof(prefix_) + 10);
+        std::memcpy(ptr, prefix_, sizeof(prefix_) - 1);
+        ptr += sizeof(prefix_) - 1;
+        *ptr++ = '.';
+        for (int i = 8; i >= 0; --i) {
+            ptr[i] = static_cast< char >('0' + nanos % 10);
+            nanos /= 10;
+        }
+        buf.commit(sizeof(prefix_) + 9);
+    }
+};
+
+} /* namespace logfw */
+
+#endif /* KSERGEY_clock_111018094217 */
@@ -17,4 +17,27 @@
 #   define LOGFW_UNLIKELY(x) __builtin_expect(static_cast< bool >(x), false)
 #endif
 
+#ifndef LOGFW_CACHE_LINE_SIZE
+#   define LOGFW_CACHE_LINE_SIZE 64
+#endif
+
+/* Spin-wait loop hint */
+#ifndef LOGFW_CPU_RELAX
+#   if defined(__x86_64__) || defined(__i386__)
+#       define LOGFW_CPU_RELAX() __builtin_ia32_pause()
+#   else
+#       define LOGFW_CPU_RELAX() do {} while (false)
+#   endif
+#endif
+
+/* Longer string arguments are truncated, limit is a part of worst case record size */
+#ifndef LOGFW_STRING_MAX_LENGTH
+#   define LOGFW_STRING_MAX_LENGTH 255
+#endif
+
+/* Maximum number of encoded array elements, longer ranges are truncated */
+#ifndef LOGFW_ARRAY_MAX_SIZE
+#   define LOGFW_ARRAY_MAX_SIZE 256
+#endif
+
 #endif /* KSERGEY_compiler_290618132957 */
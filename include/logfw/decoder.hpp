@@ -13,8 +13,9 @@
 
 namespace logfw {
 
-/** Runtime argument decoder */
-class decoder
+/** Runtime argument decoder, Policy is the encoding of args */
+template< class Policy >
+class basic_decoder
 {
 private:
     /* pointer to args buffer */
@@ -24,7 +25,9 @@ private:
     std::size_t size_;
 
 public:
-    decoder(const char* buffer, std::size_t size)
+    using policy = Policy;
+
+    basic_decoder(const char* buffer, std::size_t size)
         : buffer_(buffer)
         , size_(size)
     {}
@@ -33,7 +36,7 @@ public:
     template< class T >
     LOGFW_FORCE_INLINE void decode(T& value)
     {
-        const std::size_t used = details::arg_io< T >::decode(value, buffer_, size_);
+        const std::size_t used = Policy::template io< T >::decode(value, buffer_, size_);
 
         assert( used <= size_ );
 
@@ -41,17 +44,34 @@ public:
         size_ -= used;
     }
 
+    /**
+     * Take raw bytes.
+     * @throw std::runtime_error if buffer is too small
+     */
+    LOGFW_FORCE_INLINE const char* take(std::size_t size)
+    {
+        if (LOGFW_UNLIKELY(size > size_)) {
+            throw std::runtime_error("Buffer too small");
+        }
+
+        const char* result = buffer_;
+        buffer_ += size;
+        size_ -= size;
+        return result;
+    }
+
     /** Runtime type matching */
     template< class T >
     static bool is(std::string_view str)
     {
         using raw_type = details::clear_type< T >;
-        using fmt = details::stringify< typename details::type_format< raw_type >::type >;
-        static std::string_view format(fmt::data(), fmt::size());
-        return format == str;
+        return details::parse_type_tag(str) == details::type_format< raw_type >::tag;
     }
 };
 
+/** Decoder of fixed-width arithmetic args */
+using decoder = basic_decoder< fixed_encoding >;
+
 } /* namespace logfw */
 
 #endif /* MADLIFE_decoder_021216230550_MADLIFE */
@@ -0,0 +1,270 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_buffer_write_impl_081018162241
+#define KSERGEY_buffer_write_impl_081018162241
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "../buffer.hpp"
+#include "../decoder.hpp"
+#include "write_impl.hpp"
+
+/*
+ * Formatting into logfw::buffer.
+ *
+ * Output is byte-identical to formatting into std::ostream with flags
+ * applied by apply_format_spec() in "C" locale.
+ */
+
+namespace logfw::details {
+
+/* Write string aligned inside field width */
+LOGFW_FORCE_INLINE void format_padded(buffer& buf, const format_spec& spec, const char* str, std::size_t size)
+{
+    if (LOGFW_LIKELY(spec.width <= size)) {
+        buf.append(str, size);
+        return;
+    }
+
+    const std::size_t padding = spec.width - size;
+    const char fill = spec.zero ? '0' : ' ';
+    if (spec.left) {
+        buf.append(str, size);
+        buf.append(padding, fill);
+    } else {
+        buf.append(padding, fill);
+        buf.append(str, size);
+    }
+}
+
+/* Character types are written as characters by std::ostream */
+template< class T >
+LOGFW_FORCE_INLINE void format_char(buffer& buf, const format_spec& spec, T value)
+{
+    const char ch = static_cast< char >(value);
+    format_padded(buf, spec, &ch, 1);
+}
+
+template< class T >
+LOGFW_FORCE_INLINE void format_integer(buffer& buf, const format_spec& spec, T value)
+{
+    char str[32];
+    char* first = str + 1;
+    char* last;
+
+    if (spec.hex) {
+        /* Hex output is unsigned, sign flag ignored */
+        last = std::to_chars(first, std::end(str), static_cast< std::make_unsigned_t< T > >(value), 16).ptr;
+    } else {
+        last = std::to_chars(first, std::end(str), value).ptr;
+        if constexpr (std::is_signed_v< T >) {
+            if (spec.plus && value >= 0) {
+                *--first = '+';
+            }
+        }
+    }
+
+    format_padded(buf, spec, first, last - first);
+}
+
+LOGFW_FORCE_INLINE void format_float(buffer& buf, const format_spec& spec, double value)
+{
+    char str[128];
+    char* first = str + 1;
+
+    /* std::ostream uses "%.*f" with precision set and "%.6g" otherwise */
+    auto result = spec.precision > 0
+        ? std::to_chars(first, std::end(str), value, std::chars_format::fixed, spec.precision)
+        : std::to_chars(first, std::end(str), value, std::chars_format::general, 6);
+
+    if (LOGFW_UNLIKELY(result.ec != std::errc{})) {
+        /* Huge value in fixed format */
+        std::vector< char > tmp(spec.precision + 512);
+        first = tmp.data() + 1;
+        result = std::to_chars(first, tmp.data() + tmp.size(), value, std::chars_format::fixed, spec.precision);
+        if (spec.plus && !std::signbit(value)) {
+            *--first = '+';
+        }
+        format_padded(buf, spec, first, result.ptr - first);
+        return;
+    }
+
+    if (spec.plus && !std::signbit(value)) {
+        *--first = '+';
+    }
+
+    format_padded(buf, spec, first, result.ptr - first);
+}
+
+/* Pointer is written as hex with "0x" prefix, null pointer as "0" */
+LOGFW_FORCE_INLINE void format_pointer(buffer& buf, const format_spec& spec, const void* value)
+{
+    char str[32];
+    char* first = str + 2;
+    char* last = std::to_chars(first, std::end(str), reinterpret_cast< std::uintptr_t >(value), 16).ptr;
+
+    if (value) {
+        *--first = 'x';
+        *--first = '0';
+    }
+
+    format_padded(buf, spec, first, last - first);
+}
+
+LOGFW_FORCE_INLINE void format_value(buffer& buf, const format_spec& spec, std::int8_t value)
+{
+    format_char(buf, spec, value);
+}
+
+LOGFW_FORCE_INLINE void format_value(buffer& buf, const format_spec& spec, std::uint8_t value)
+{
+    format_char(buf, spec, value);
+}
+
+LOGFW_FORCE_INLINE void format_value(buffer& buf, const format_spec& spec, char value)
+{
+    format_char(buf, spec, value);
+}
+
+LOGFW_FORCE_INLINE void format_value(buffer& buf, const format_spec& spec, std::int16_t value)
+{
+    format_integer(buf, spec, value);
+}
+
+LOGFW_FORCE_INLINE void format_value(buffer& buf, const format_spec& spec, std::uint16_t value)
+{
+    format_integer(buf, spec, value);
+}
+
+LOGFW_FORCE_INLINE void format_value(buffer& buf, const format_spec& spec, std::int32_t value)
+{
+    format_integer(buf, spec, value);
+}
+
+LOGFW_FORCE_INLINE void format_value(buffer& buf, const format_spec& spec, std::uint32_t value)
+{
+    format_integer(buf, spec, value);
+}
+
+LOGFW_FORCE_INLINE void format_value(buffer& buf, const format_spec& spec, std::int64_t value)
+{
+    format_integer(buf, spec, value);
+}
+
+LOGFW_FORCE_INLINE void format_value(buffer& buf, const format_spec& spec, std::uint64_t value)
+{
+    format_integer(buf, spec, value);
+}
+
+LOGFW_FORCE_INLINE void format_value(buffer& buf, const format_spec& spec, double value)
+{
+    format_float(buf, spec, value);
+}
+
+LOGFW_FORCE_INLINE void format_value(buffer& buf, const format_spec& spec, float value)
+{
+    format_float(buf, spec, value);
+}
+
+LOGFW_FORCE_INLINE void format_value(buffer& buf, const format_spec& spec, std::string_view value)
+{
+    format_padded(buf, spec, value.data(), value.size());
+}
+
+LOGFW_FORCE_INLINE void format_value(buffer& buf, const format_spec& spec, const void* value)
+{
+    format_pointer(buf, spec, value);
+}
+
+/* Decode and write argument into buffer */
+template< class T >
+struct buffer_value_writer
+{
+    template< class Decoder >
+    static void run(buffer& buf, const format_spec& spec, Decoder& d)
+    {
+        T value;
+        d.decode(value);
+        format_value(buf, spec, value);
+    }
+};
+
+template< class T >
+struct buffer_value_writer< T* >
+{
+    template< class Decoder >
+    static void run(buffer& buf, const format_spec& spec, Decoder& d)
+    {
+        void* value;
+        d.decode(value);
+        format_value(buf, spec, static_cast< const void* >(value));
+    }
+};
+
+template<>
+struct buffer_value_writer< std::string_view >
+{
+    template< class Decoder >
+    static void run(buffer& buf, const format_spec& spec, Decoder& d)
+    {
+        string_arg value;
+        d.decode(value);
+        format_value(buf, spec, value.value);
+        if (LOGFW_UNLIKELY(value.truncated)) {
+            buf.append(truncation_marker);
+        }
+    }
+};
+
+template<>
+struct buffer_value_writer< literal >
+{
+    template< class Decoder >
+    static void run(buffer& buf, const format_spec& spec, Decoder& d)
+    {
+        literal value;
+        d.decode(value);
+        format_value(buf, spec, find_literal(value));
+    }
+};
+
+/* Parser handler, writes format into buffer */
+template< class Decoder >
+struct buffer_format_writer
+{
+    buffer& buf;
+    std::string_view fmt;
+    Decoder& dec;
+
+    void literal(std::size_t offset, std::size_t size)
+    {
+        buf.append(fmt.data() + offset, size);
+    }
+
+    void arg(std::string_view type, std::string_view flags)
+    {
+        const type_tag tag = parse_type_tag(type);
+        if (LOGFW_UNLIKELY(tag == type_tag::user)) {
+            write_user_arg(buf, find_user_type(type), parse_format_spec(flags), dec);
+            return;
+        }
+        if (LOGFW_UNLIKELY(tag == type_tag::array)) {
+            write_array< buffer_value_writer >(parse_element_tag(type), buf, parse_format_spec(flags), dec);
+            return;
+        }
+
+        dispatch_writer< buffer_value_writer >(tag, buf, parse_format_spec(flags), dec);
+    }
+};
+
+} // namespace logfw::details
+
+#endif /* KSERGEY_buffer_write_impl_081018162241 */
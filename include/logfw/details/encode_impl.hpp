@@ -6,21 +6,59 @@
 #define MADLIFE_encode_impl_021216225339_MADLIFE
 
 #include <algorithm>
+#include <array>
 #include <cstring>
 #include <limits>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <utility>
 
 #include "../compiler.hpp"
+#include "type_format.hpp"
+#include "user_type_impl.hpp"
+#include "varint.hpp"
 
 namespace logfw::details {
 
 /**
  * Maximum length of loggable string.
- * Strings will be trimed in case of greater 256 chars.
+ * Longer strings are truncated and rendered with truncation marker.
  */
-static constexpr const std::size_t string_max_length = std::numeric_limits< std::uint8_t >::max();
+static constexpr const std::size_t string_max_length = LOGFW_STRING_MAX_LENGTH;
+
+/*
+ * Prefix of truncated string, non-canonical LEB128 zero which is never
+ * produced for a length.
+ */
+static constexpr const char truncated_prefix[2] = {char(0x80), char(0x00)};
+
+/* Rendered after truncated string */
+static constexpr std::string_view truncation_marker = "[truncated]";
+
+/** Decoded string argument */
+struct string_arg
+{
+    std::string_view value;
+    /* String was longer than string_max_length */
+    bool truncated{false};
+};
+
+/**
+ * Maximum number of elements of loggable array.
+ * Longer arrays are truncated and rendered with "..." at the end.
+ */
+static constexpr const std::size_t array_max_size = LOGFW_ARRAY_MAX_SIZE;
+
+/** Decoded array argument, elements follow in the buffer */
+struct array_arg
+{
+    /* Number of encoded elements */
+    std::size_t count{0};
+    /* Array was longer than array_max_size */
+    bool truncated{false};
+};
 
 /** Argument i/o handlers */
 template< class T, class Enable = void >
@@ -36,7 +74,7 @@ struct arg_io< T, std::enable_if_t< std::is_arithmetic_v< T > > >
     }
 
     /** @return Numbers of actual bytes required for store the arg */
-    static constexpr std::size_t bytes_required(const T& value) noexcept
+    static constexpr std::size_t bytes_required(const T&) noexcept
     {
         return sizeof(T);
     }
@@ -68,50 +106,93 @@ struct arg_io< T, std::enable_if_t< std::is_arithmetic_v< T > > >
 template<>
 struct arg_io< std::string_view >
 {
+    /* Worst case is much larger than the usual size (see has_variable_size) */
+    static constexpr bool variable_size = true;
+
     /** @return Maximum numbers of bytes to store the type in the buffer. */
     static constexpr std::size_t max_bytes_required() noexcept
     {
-        return string_max_length + 1;
+        return sizeof(truncated_prefix) + varint_size(string_max_length) + string_max_length;
     }
 
     /** @return Numbers of actual bytes required for store the arg. */
     static constexpr std::size_t bytes_required(std::string_view value)
     {
-        const std::size_t size = std::min< std::size_t >(value.size(), string_max_length);
-        return size + 1;
+        if (LOGFW_UNLIKELY(value.size() > string_max_length)) {
+            return max_bytes_required();
+        }
+        return varint_size(value.size()) + value.size();
     }
 
     /**
      * Copy type to buffer.
      * @return Used bytes.
      *
-     * layout: [str-size][str-bytes]
+     * layout: [str-size (LEB128)][str-bytes]
+     *     or: [truncated_prefix][str-size (LEB128)][str-bytes] for truncated string
      */
-    static constexpr std::size_t encode(std::string_view value, char* buffer) noexcept
+    static LOGFW_FORCE_INLINE std::size_t encode(std::string_view value, char* buffer) noexcept
     {
-        const std::size_t size = std::min< std::size_t >(value.size(), string_max_length);
-        buffer[0] = std::uint8_t(size);
-        std::memcpy(buffer + 1, value.data(), size);
-        return size + 1;
+        char* ptr = buffer;
+        std::size_t size = value.size();
+        if (LOGFW_UNLIKELY(size > string_max_length)) {
+            std::memcpy(ptr, truncated_prefix, sizeof(truncated_prefix));
+            ptr += sizeof(truncated_prefix);
+            size = string_max_length;
+        }
+
+        if (LOGFW_LIKELY(size < 0x80)) {
+            *ptr++ = static_cast< char >(size);
+        } else {
+            ptr += encode_varint(size, ptr);
+        }
+
+        std::memcpy(ptr, value.data(), size);
+        return (ptr - buffer) + size;
     }
 
     /**
      * Copy type from buffer.
      * @return Used bytes.
      */
-    static constexpr std::size_t decode(std::string_view& value, const char* buffer, std::size_t size)
+    static std::size_t decode(string_arg& value, const char* buffer, std::size_t size)
     {
-        if (LOGFW_UNLIKELY(size == 0)) {
-            throw std::runtime_error{"Buffer too small"};
+        std::size_t used = 0;
+        value.truncated = size >= sizeof(truncated_prefix)
+            && std::memcmp(buffer, truncated_prefix, sizeof(truncated_prefix)) == 0;
+        if (LOGFW_UNLIKELY(value.truncated)) {
+            used += sizeof(truncated_prefix);
         }
 
-        const std::size_t bytes = std::size_t(buffer[0]);
-        if (LOGFW_UNLIKELY(bytes + 1 > size)) {
+        std::uint64_t bytes;
+        used += decode_varint(bytes, buffer + used, size - used);
+        if (LOGFW_UNLIKELY(bytes > size - used)) {
             throw std::runtime_error{"Buffer too small"};
         }
 
-        value = {buffer + 1, bytes};
-        return bytes + 1;
+        value.value = {buffer + used, bytes};
+        return used + bytes;
+    }
+
+    /**
+     * Copy type from buffer, truncation is ignored.
+     * @return Used bytes.
+     */
+    static std::size_t decode(std::string_view& value, const char* buffer, std::size_t size)
+    {
+        string_arg arg;
+        const std::size_t used = decode(arg, buffer, size);
+        value = arg.value;
+        return used;
+    }
+};
+
+template<>
+struct arg_io< string_arg >
+{
+    static std::size_t decode(string_arg& value, const char* buffer, std::size_t size)
+    {
+        return arg_io< std::string_view >::decode(value, buffer, size);
     }
 };
 
@@ -128,31 +209,31 @@ struct arg_io< std::string >
 template< std::size_t N >
 struct arg_io< char[N] >
 {
-    static_assert( N < 256, "" );
+    static_assert( N - 1 <= string_max_length, "String literal is longer than string_max_length" );
 
     /** Return maximum numbers of bytes to store the type in the buffer */
     static constexpr std::size_t max_bytes_required() noexcept
     {
-        return N;
+        return varint_size(N - 1) + N - 1;
     }
 
     /** Return numbers of actual bytes required for store the arg */
-    static constexpr std::size_t bytes_required(const char (&value)[N]) noexcept
+    static constexpr std::size_t bytes_required(const char (&)[N]) noexcept
     {
-        return N;
+        return max_bytes_required();
     }
 
     /**
      * Copy type to buffer.
      * @return used bytes
      *
-     * layout: [str-size][str-bytes]
+     * layout: [str-size (LEB128)][str-bytes]
      */
-    static constexpr std::size_t encode(const char (&value)[N], char* buffer) noexcept
+    static LOGFW_FORCE_INLINE std::size_t encode(const char (&value)[N], char* buffer) noexcept
     {
-        buffer[0] = static_cast< std::uint8_t >(N - 1);
-        std::memcpy(buffer + 1, value, N - 1);
-        return N;
+        const std::size_t used = encode_varint(N - 1, buffer);
+        std::memcpy(buffer + used, value, N - 1);
+        return used + N - 1;
     }
 };
 
@@ -199,11 +280,209 @@ struct arg_io< T, std::enable_if_t< std::is_pointer_v< T > > >
     }
 };
 
-template< class... Args >
-struct encode_impl;
+template< class T >
+struct arg_io< T, std::enable_if_t< is_user_type_v< T > > >
+{
+    using encoded_type = user_encoded_type_t< T >;
+
+    static constexpr std::size_t max_bytes_required() noexcept
+    {
+        return sizeof(encoded_type);
+    }
+
+    static constexpr std::size_t bytes_required(const T&) noexcept
+    {
+        return sizeof(encoded_type);
+    }
+
+    /**
+     * Copy encoded representation to buffer.
+     * @return Used bytes.
+     */
+    static LOGFW_FORCE_INLINE std::size_t encode(const T& value, char* buffer) noexcept
+    {
+        /* Make type known to runtime parsed formats */
+        (void) user_type_entry< T >::registered;
+
+        const encoded_type& encoded = user_encode(value);
+        std::memcpy(buffer, &encoded, sizeof(encoded_type));
+        return sizeof(encoded_type);
+    }
+};
+
+template< class T >
+struct arg_io< T, std::enable_if_t< is_arithmetic_range_v< T > > >
+{
+    using value_type = range_value_t< T >;
+
+    /* Worst case is much larger than the usual size (see has_variable_size) */
+    static constexpr bool variable_size = true;
+
+    /** @return Maximum numbers of bytes to store the type in the buffer */
+    static constexpr std::size_t max_bytes_required() noexcept
+    {
+        return sizeof(truncated_prefix) + varint_size(array_max_size) + array_max_size * sizeof(value_type);
+    }
+
+    /** @return Numbers of actual bytes required for store the arg */
+    static constexpr std::size_t bytes_required(const T& value) noexcept
+    {
+        const std::size_t count = std::size(value);
+        if (LOGFW_UNLIKELY(count > array_max_size)) {
+            return max_bytes_required();
+        }
+        return varint_size(count) + count * sizeof(value_type);
+    }
+
+    /**
+     * Copy elements to buffer with a single memcpy.
+     * @return Used bytes.
+     *
+     * layout: [count (LEB128)][elements]
+     *     or: [truncated_prefix][count (LEB128)][elements] for truncated array
+     */
+    static LOGFW_FORCE_INLINE std::size_t encode(const T& value, char* buffer) noexcept
+    {
+        char* ptr = buffer;
+        std::size_t count = std::size(value);
+        if (LOGFW_UNLIKELY(count > array_max_size)) {
+            std::memcpy(ptr, truncated_prefix, sizeof(truncated_prefix));
+            ptr += sizeof(truncated_prefix);
+            count = array_max_size;
+        }
+
+        ptr += encode_varint(count, ptr);
+
+        const std::size_t bytes = count * sizeof(value_type);
+        if (LOGFW_LIKELY(bytes > 0)) {
+            std::memcpy(ptr, std::data(value), bytes);
+        }
+        return (ptr - buffer) + bytes;
+    }
+};
 
 template<>
-struct encode_impl<>
+struct arg_io< array_arg >
+{
+    /**
+     * Read array header, elements are decoded one by one after it.
+     * @return Used bytes.
+     */
+    static std::size_t decode(array_arg& value, const char* buffer, std::size_t size)
+    {
+        std::size_t used = 0;
+        value.truncated = size >= sizeof(truncated_prefix)
+            && std::memcmp(buffer, truncated_prefix, sizeof(truncated_prefix)) == 0;
+        if (LOGFW_UNLIKELY(value.truncated)) {
+            used += sizeof(truncated_prefix);
+        }
+
+        std::uint64_t count;
+        used += decode_varint(count, buffer + used, size - used);
+        if (LOGFW_UNLIKELY(count > size - used)) {
+            /* Each element takes at least one byte */
+            throw std::runtime_error{"Buffer too small"};
+        }
+
+        value.count = static_cast< std::size_t >(count);
+        return used;
+    }
+};
+
+/* @return Zigzag mapping of signed value, small magnitudes become small numbers */
+template< class T >
+constexpr std::make_unsigned_t< T > zigzag_encode(T value) noexcept
+{
+    using unsigned_type = std::make_unsigned_t< T >;
+    if constexpr (std::is_signed_v< T >) {
+        return (unsigned_type(value) << 1) ^ unsigned_type(value >> (sizeof(T) * 8 - 1));
+    } else {
+        return value;
+    }
+}
+
+/* @return Value of zigzag mapping */
+template< class T >
+constexpr T zigzag_decode(std::make_unsigned_t< T > value) noexcept
+{
+    if constexpr (std::is_signed_v< T >) {
+        return T((value >> 1) ^ (~(value & 1) + 1));
+    } else {
+        return value;
+    }
+}
+
+/** Integer i/o as zigzag + LEB128 (see compact_encoding) */
+template< class T >
+struct varint_io
+{
+    static constexpr std::size_t max_bytes_required() noexcept
+    {
+        return varint_size(std::numeric_limits< std::make_unsigned_t< T > >::max());
+    }
+
+    static constexpr std::size_t bytes_required(T value) noexcept
+    {
+        return varint_size(zigzag_encode(value));
+    }
+
+    /**
+     * Copy type to buffer.
+     * @return Used bytes.
+     */
+    static LOGFW_FORCE_INLINE std::size_t encode(T value, char* buffer) noexcept
+    {
+        return encode_varint(zigzag_encode(value), buffer);
+    }
+
+    /**
+     * Copy type from buffer.
+     * @return Used bytes.
+     */
+    static LOGFW_FORCE_INLINE std::size_t decode(T& value, const char* buffer, std::size_t size)
+    {
+        std::uint64_t raw;
+        const std::size_t used = decode_varint(raw, buffer, size);
+        value = zigzag_decode< T >(static_cast< std::make_unsigned_t< T > >(raw));
+        return used;
+    }
+};
+
+/* true if T is encoded as varint by compact_encoding, single bytes are kept as is */
+template< class T >
+constexpr bool is_compact_integer_v = std::is_integral_v< T > && !std::is_same_v< T, bool > && (sizeof(T) > 1);
+
+} // namespace logfw::details
+
+namespace logfw {
+
+/** Encoding policy: arithmetic args take sizeof(T) bytes */
+struct fixed_encoding
+{
+    template< class T >
+    using io = details::arg_io< T >;
+};
+
+/**
+ * Encoding policy: integers wider than a byte are stored as zigzag + LEB128,
+ * other args as with fixed_encoding. Small values and values close to zero
+ * take 1-2 bytes instead of 8.
+ */
+struct compact_encoding
+{
+    template< class T >
+    using io = std::conditional_t< details::is_compact_integer_v< T >, details::varint_io< T >, details::arg_io< T > >;
+};
+
+} /* namespace logfw */
+
+namespace logfw::details {
+
+template< class Policy, class... Args >
+struct encode_impl;
+
+template< class Policy >
+struct encode_impl< Policy >
 {
     static constexpr std::size_t encode([[maybe_unused]] char* buffer) noexcept
     {
@@ -221,48 +500,132 @@ struct encode_impl<>
     }
 };
 
-template< class T >
-struct encode_impl< T >
+template< class Policy, class T >
+struct encode_impl< Policy, T >
 {
+    using io = typename Policy::template io< T >;
+
     static constexpr std::size_t encode(const T& value, char* buffer)
     {
-        return arg_io< T >::encode(value, buffer);
+        return io::encode(value, buffer);
     }
 
     static constexpr std::size_t max_bytes_required()
     {
-        return arg_io< T >::max_bytes_required();
+        return io::max_bytes_required();
     }
 
     static constexpr std::size_t bytes_required(const T& value)
     {
-        return arg_io< T >::max_bytes_required(value);
+        return io::bytes_required(value);
     }
 };
 
-template< class T, class... Args >
-struct encode_impl< T, Args... >
+template< class Policy, class T, class... Args >
+struct encode_impl< Policy, T, Args... >
 {
     static constexpr std::size_t encode(const T& value, const Args&... args, char* buffer)
     {
         /* Encode type */
-        const std::size_t encoded_size = encode_impl< T >::encode(value, buffer);
+        const std::size_t encoded_size = encode_impl< Policy, T >::encode(value, buffer);
 
         /* Encode rest args */
-        return encoded_size + encode_impl< Args... >::encode(args..., buffer + encoded_size);
+        return encoded_size + encode_impl< Policy, Args... >::encode(args..., buffer + encoded_size);
     }
 
     static constexpr std::size_t max_bytes_required()
     {
-        return encode_impl< T >::max_bytes_required() + encode_impl< Args... >::max_bytes_required();
+        return encode_impl< Policy, T >::max_bytes_required() + encode_impl< Policy, Args... >::max_bytes_required();
     }
 
     static constexpr std::size_t bytes_required(const T& value, const Args&... args)
     {
-        return encode_impl< T >::bytes_required(value) + encode_impl< Args... >::bytes_required(args...);
+        return encode_impl< Policy, T >::bytes_required(value) + encode_impl< Policy, Args... >::bytes_required(args...);
     }
 };
 
+/* true if encoded size of arg i/o handler IO is known only from the value (strings, arrays) */
+template< class IO, class = void >
+struct has_variable_size
+    : std::false_type
+{};
+
+template< class IO >
+struct has_variable_size< IO, std::void_t< decltype(IO::variable_size) > >
+    : std::bool_constant< IO::variable_size >
+{};
+
+/*
+ * true if T is encoded as its own bytes (see arg_io for arithmetic and
+ * pointer types), char pointers are strings
+ */
+template< class T >
+constexpr bool is_fixed_layout_v = std::is_arithmetic_v< T >
+    || (std::is_pointer_v< T > && !std::is_same_v< std::remove_cv_t< std::remove_pointer_t< T > >, char >);
+
+/**
+ * Encoder of argument pack of arithmetic and pointer types.
+ *
+ * Args are stored as a packed struct with constexpr offsets, encoding is
+ * a sequence of unaligned stores the compiler is free to merge. Layout is
+ * the same as of encode_impl with fixed_encoding, i.e. args follow each
+ * other without padding.
+ */
+template< class... Args >
+struct fixed_layout_impl
+{
+    static_assert( (is_fixed_layout_v< Args > && ...) );
+
+    /* Encoded size of all args */
+    static constexpr std::size_t size = (std::size_t(0) + ... + sizeof(Args));
+
+    /* Offsets of args in the buffer */
+    static constexpr std::array< std::size_t, sizeof...(Args) > offsets = [] {
+        std::array< std::size_t, sizeof...(Args) > result{};
+        const std::size_t sizes[] = {sizeof(Args)..., 0};
+        std::size_t offset = 0;
+        for (std::size_t i = 0; i < sizeof...(Args); ++i) {
+            result[i] = offset;
+            offset += sizes[i];
+        }
+        return result;
+    }();
+
+    /* Layout compatible with arg_io of each arg */
+    static_assert( size == encode_impl< fixed_encoding, Args... >::max_bytes_required() );
+
+    static LOGFW_FORCE_INLINE std::size_t encode(const Args&... args, char* buffer) noexcept
+    {
+        store(buffer, std::index_sequence_for< Args... >{}, args...);
+        return size;
+    }
+
+    static constexpr std::size_t max_bytes_required() noexcept
+    {
+        return size;
+    }
+
+    static constexpr std::size_t bytes_required(const Args&...) noexcept
+    {
+        return size;
+    }
+
+private:
+    template< std::size_t... I >
+    static LOGFW_FORCE_INLINE void store(char* buffer, std::index_sequence< I... >, const Args&... args) noexcept
+    {
+        (std::memcpy(buffer + offsets[I], &args, sizeof(Args)), ...);
+    }
+};
+
+/* Encoder of argument pack, fixed_layout_impl is selected when possible */
+template< class Policy, class... Args >
+using encode_impl_t = std::conditional_t<
+    std::is_same_v< Policy, fixed_encoding > && (sizeof...(Args) > 0) && (is_fixed_layout_v< Args > && ...),
+        fixed_layout_impl< Args... >,
+        encode_impl< Policy, Args... >
+>;
+
 } // namespace logfw::details
 
 #endif /* MADLIFE_encode_impl_021216225339_MADLIFE */
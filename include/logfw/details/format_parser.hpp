@@ -0,0 +1,137 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_format_parser_061018114730
+#define KSERGEY_format_parser_061018114730
+
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+#include "buffer_write_impl.hpp"
+#include "write_impl.hpp"
+
+namespace logfw::details {
+
+/* Compiled format operation, literal text span or argument */
+struct format_op
+{
+    /* Literal text offset in format string */
+    std::uint32_t offset{0};
+    /* Literal text size */
+    std::uint32_t size{0};
+    /* Argument type, type_tag::none for literal text */
+    type_tag tag{type_tag::none};
+    /* Argument formatting flags */
+    format_spec spec;
+    /* User type of argument (type_tag::user) */
+    const user_type_info* user{nullptr};
+    /* Element type of array argument (type_tag::array) */
+    type_tag element{type_tag::none};
+};
+
+/* constexpr friendly std::string_view::find(char) */
+constexpr std::size_t find_char(std::string_view str, char ch, std::size_t pos = 0) noexcept
+{
+    for (; pos < str.size(); ++pos) {
+        if (str[pos] == ch) {
+            return pos;
+        }
+    }
+    return std::string_view::npos;
+}
+
+/**
+ * Split format string into literal spans and arguments.
+ *
+ * Calls handler.literal(offset, size) for each literal span ("{{" and "}}"
+ * produce a span with a single brace) and handler.arg(type, flags) for each
+ * argument. Usable in constant expressions.
+ */
+template< class Handler >
+constexpr void parse_format(std::string_view fmt, Handler& handler)
+{
+    /* Start of current literal text */
+    std::size_t literal = 0;
+
+    for (std::size_t index = 0; index < fmt.size(); ++index) {
+        char ch = fmt[index];
+
+        if (ch == '{') {
+
+            if (next_is< '{' >(fmt, index)) {
+                /* Keep first brace in literal, skip second */
+                handler.literal(literal, index + 1 - literal);
+                ++index;
+                literal = index + 1;
+            } else {
+                /* find close brace */
+                auto found = find_char(fmt, '}', index + 1);
+                if (LOGFW_UNLIKELY(found == std::string_view::npos)) {
+                    throw std::runtime_error("format error (close brace not found)");
+                }
+
+                if (index > literal) {
+                    handler.literal(literal, index - literal);
+                }
+
+                /* find type:spec delimiter */
+                auto spec = fmt.substr(index + 1, found - index - 1);
+                auto delimiter = find_char(spec, ':');
+                if (delimiter == std::string_view::npos) {
+                    handler.arg(spec, std::string_view{});
+                } else {
+                    handler.arg(spec.substr(0, delimiter), spec.substr(delimiter + 1));
+                }
+
+                /* skip specifier */
+                index = found;
+                literal = index + 1;
+            }
+
+        } else if (ch == '}') {
+
+            if (LOGFW_LIKELY(next_is< '}' >(fmt, index))) {
+                handler.literal(literal, index + 1 - literal);
+                ++index;
+                literal = index + 1;
+            } else {
+                throw std::runtime_error("format error (unexpected close brace)");
+            }
+
+        }
+    }
+
+    if (fmt.size() > literal) {
+        handler.literal(literal, fmt.size() - literal);
+    }
+}
+
+/* Counts format operations */
+struct op_counter
+{
+    std::size_t count{0};
+
+    constexpr void literal(std::size_t, std::size_t) noexcept
+    {
+        ++count;
+    }
+
+    constexpr void arg(std::string_view, std::string_view) noexcept
+    {
+        ++count;
+    }
+};
+
+/* @return Number of operations in format */
+constexpr std::size_t count_format_ops(std::string_view fmt)
+{
+    op_counter counter;
+    parse_format(fmt, counter);
+    return counter.count;
+}
+
+} // namespace logfw::details
+
+#endif /* KSERGEY_format_parser_061018114730 */
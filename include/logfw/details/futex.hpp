@@ -0,0 +1,39 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_futex_031018120533
+#define KSERGEY_futex_031018120533
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace logfw::details {
+
+static_assert( sizeof(std::atomic< std::uint32_t >) == sizeof(std::uint32_t) );
+
+/** Sleep while value at address equals expected or until timeout expired */
+inline void futex_wait(std::atomic< std::uint32_t >& word, std::uint32_t expected,
+        std::chrono::nanoseconds timeout) noexcept
+{
+    struct timespec ts;
+    ts.tv_sec = timeout.count() / 1000000000;
+    ts.tv_nsec = timeout.count() % 1000000000;
+    ::syscall(SYS_futex, reinterpret_cast< std::uint32_t* >(&word), FUTEX_WAIT_PRIVATE, expected, &ts, nullptr, 0);
+}
+
+/** Wake up all waiters on address */
+inline void futex_wake(std::atomic< std::uint32_t >& word) noexcept
+{
+    ::syscall(SYS_futex, reinterpret_cast< std::uint32_t* >(&word), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+}
+
+} // namespace logfw::details
+
+#endif /* KSERGEY_futex_031018120533 */
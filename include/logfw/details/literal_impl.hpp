@@ -0,0 +1,125 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_literal_impl_121018143056
+#define KSERGEY_literal_impl_121018143056
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+#include "../compiler.hpp"
+#include "encode_impl.hpp"
+#include "type_format.hpp"
+
+namespace logfw {
+
+/**
+ * String with static storage duration.
+ * Encoded as id of the string in format_registry (see LOGFW_LITERAL).
+ */
+class literal
+{
+private:
+    std::uint32_t id_{0};
+
+public:
+    constexpr literal() = default;
+
+    constexpr explicit literal(std::uint32_t id) noexcept
+        : id_(id)
+    {}
+
+    /** @return Registry id of the string */
+    constexpr std::uint32_t id() const noexcept
+    {
+        return id_;
+    }
+};
+
+} /* namespace logfw */
+
+namespace logfw::details {
+
+template<>
+struct type_format< literal >
+{
+    static constexpr std::string_view name = "l";
+    static constexpr type_tag tag = type_tag::l;
+};
+
+template<>
+struct arg_io< literal >
+{
+    static constexpr std::size_t max_bytes_required() noexcept
+    {
+        return sizeof(std::uint32_t);
+    }
+
+    static constexpr std::size_t bytes_required(literal) noexcept
+    {
+        return sizeof(std::uint32_t);
+    }
+
+    static LOGFW_FORCE_INLINE std::size_t encode(literal value, char* buffer) noexcept
+    {
+        const std::uint32_t id = value.id();
+        std::memcpy(buffer, &id, sizeof(id));
+        return sizeof(id);
+    }
+
+    static std::size_t decode(literal& value, const char* buffer, std::size_t size)
+    {
+        if (LOGFW_UNLIKELY(size < sizeof(std::uint32_t))) {
+            throw std::runtime_error("Buffer too small");
+        }
+        std::uint32_t id;
+        std::memcpy(&id, buffer, sizeof(id));
+        value = literal{id};
+        return sizeof(id);
+    }
+};
+
+/** Dictionary for literal text lookup while rendering */
+struct literal_source
+{
+    /* @return false if there is no literal with the id */
+    bool (*find)(void* context, std::uint32_t id, std::string_view& value){nullptr};
+    void* context{nullptr};
+};
+
+/* Process dictionary, installed by format_registry */
+inline literal_source& default_literal_source() noexcept
+{
+    static literal_source source;
+    return source;
+}
+
+/* Dictionary of the rendering thread (records of other process), see literal_scope */
+inline literal_source& local_literal_source() noexcept
+{
+    static thread_local literal_source source;
+    return source;
+}
+
+/**
+ * @return Literal text
+ * @throw std::runtime_error if literal is unknown
+ */
+inline std::string_view find_literal(literal value)
+{
+    const literal_source& local = local_literal_source();
+    const literal_source& source = local.find ? local : default_literal_source();
+
+    std::string_view result;
+    if (LOGFW_UNLIKELY(!source.find || !source.find(source.context, value.id(), result))) {
+        throw std::runtime_error("Unknown literal id");
+    }
+    return result;
+}
+
+} // namespace logfw::details
+
+#endif /* KSERGEY_literal_impl_121018143056 */
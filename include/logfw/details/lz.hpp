@@ -0,0 +1,273 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_lz_171018194612
+#define KSERGEY_lz_171018194612
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "../compiler.hpp"
+
+/*
+ * LZ77 block compression (LZ4-like sequence format).
+ *
+ * layout of a block: [sequence]...
+ * sequence: [token][literal-length-ext][literals][offset (2 bytes)][match-length-ext]
+ *
+ * token holds literal length (high 4 bits) and match length - 4 (low 4 bits),
+ * value 15 is continued in extension bytes: 255, 255, ..., remainder.
+ * The last sequence holds literals only and ends the block.
+ */
+
+namespace logfw::details {
+
+/* Shortest encoded match */
+static constexpr std::size_t lz_min_match = 4;
+/* Max match distance */
+static constexpr std::size_t lz_max_offset = 65535;
+/* Bytes at the end of a block which are always literals */
+static constexpr std::size_t lz_last_literals = 5;
+
+/** @return Max size of compressed block */
+constexpr std::size_t lz_bound(std::size_t size) noexcept
+{
+    return size + size / 255 + 16;
+}
+
+LOGFW_FORCE_INLINE std::uint32_t lz_load32(const unsigned char* ptr) noexcept
+{
+    std::uint32_t value;
+    std::memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+LOGFW_FORCE_INLINE std::uint64_t lz_load64(const unsigned char* ptr) noexcept
+{
+    std::uint64_t value;
+    std::memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+/* Copy in 8 byte steps, might write up to 7 bytes past dst + size */
+LOGFW_FORCE_INLINE void lz_wild_copy(unsigned char* dst, const unsigned char* src, std::size_t size) noexcept
+{
+    unsigned char* const end = dst + size;
+    do {
+        std::memcpy(dst, src, 8);
+        dst += 8;
+        src += 8;
+    } while (dst < end);
+}
+
+LOGFW_FORCE_INLINE unsigned char* lz_write_length(unsigned char* out, std::size_t length) noexcept
+{
+    while (length >= 255) {
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = static_cast< unsigned char >(length);
+    return out;
+}
+
+/**
+ * Greedy single-pass compressor with hash table of last positions.
+ * Table is owned by the object to be reused between blocks.
+ */
+class lz_compressor
+{
+private:
+    static constexpr unsigned hash_bits = 14;
+
+    /* Position + 1 of the last sequence with the hash, zero if there is none */
+    std::uint32_t table_[std::size_t(1) << hash_bits];
+
+public:
+    /**
+     * Compress block.
+     * @param[out] dst is buffer of at least lz_bound(size) bytes
+     * @return Compressed size
+     */
+    std::size_t compress(const char* src, std::size_t size, char* dst) noexcept
+    {
+        std::memset(table_, 0, sizeof(table_));
+
+        const auto* in = reinterpret_cast< const unsigned char* >(src);
+        auto* out = reinterpret_cast< unsigned char* >(dst);
+
+        std::size_t anchor = 0;
+        std::size_t pos = 0;
+        /* Matches start before the limit and end before the last literals */
+        const std::size_t limit = size > lz_last_literals + lz_min_match * 2 ? size - lz_last_literals - lz_min_match : 0;
+        const std::size_t match_end = size > lz_last_literals ? size - lz_last_literals : 0;
+        /* Incompressible data is skipped faster */
+        std::size_t misses = 0;
+
+        while (pos < limit) {
+            const std::uint32_t sequence = lz_load32(in + pos);
+            const std::uint32_t hash = (sequence * 2654435761u) >> (32 - hash_bits);
+            const std::size_t candidate = table_[hash];
+            table_[hash] = static_cast< std::uint32_t >(pos + 1);
+
+            if (candidate == 0 || pos - (candidate - 1) > lz_max_offset || lz_load32(in + candidate - 1) != sequence) {
+                pos += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+
+            std::size_t match = candidate - 1;
+            std::size_t length = lz_min_match;
+            while (pos + length + 8 <= match_end) {
+                const std::uint64_t diff = lz_load64(in + match + length) ^ lz_load64(in + pos + length);
+                if (diff != 0) {
+                    if constexpr (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) {
+                        length += __builtin_ctzll(diff) >> 3;
+                    } else {
+                        length += __builtin_clzll(diff) >> 3;
+                    }
+                    break;
+                }
+                length += 8;
+            }
+            if (pos + length + 8 > match_end) {
+                while (pos + length < match_end && in[match + length] == in[pos + length]) {
+                    ++length;
+                }
+            }
+            while (pos > anchor && match > 0 && in[pos - 1] == in[match - 1]) {
+                --pos;
+                --match;
+                ++length;
+            }
+
+            out = emit(out, in + anchor, pos - anchor, pos - match, length);
+            pos += length;
+            anchor = pos;
+        }
+
+        /* Last literals */
+        const std::size_t literals = size - anchor;
+        *out++ = static_cast< unsigned char >(std::min< std::size_t >(literals, 15) << 4);
+        if (literals >= 15) {
+            out = lz_write_length(out, literals - 15);
+        }
+        std::memcpy(out, in + anchor, literals);
+        out += literals;
+
+        return out - reinterpret_cast< unsigned char* >(dst);
+    }
+
+private:
+    static LOGFW_FORCE_INLINE unsigned char* emit(unsigned char* out, const unsigned char* literals,
+            std::size_t literal_count, std::size_t offset, std::size_t length) noexcept
+    {
+        const std::size_t match = length - lz_min_match;
+
+        unsigned char* token = out++;
+        *token = static_cast< unsigned char >((std::min< std::size_t >(literal_count, 15) << 4)
+                | std::min< std::size_t >(match, 15));
+        if (literal_count >= 15) {
+            out = lz_write_length(out, literal_count - 15);
+        }
+        std::memcpy(out, literals, literal_count);
+        out += literal_count;
+
+        *out++ = static_cast< unsigned char >(offset);
+        *out++ = static_cast< unsigned char >(offset >> 8);
+
+        if (match >= 15) {
+            out = lz_write_length(out, match - 15);
+        }
+        return out;
+    }
+};
+
+/**
+ * Decompress block.
+ * @return false if the block is corrupted or doesn't decompress into exactly size bytes
+ */
+inline bool lz_decompress(const char* src, std::size_t src_size, char* dst, std::size_t size) noexcept
+{
+    const auto* in = reinterpret_cast< const unsigned char* >(src);
+    const auto* in_end = in + src_size;
+    auto* out = reinterpret_cast< unsigned char* >(dst);
+    auto* const out_begin = out;
+    auto* const out_end = out + size;
+
+    auto read_length = [&in, in_end](std::size_t& length) {
+        unsigned char byte;
+        do {
+            if (LOGFW_UNLIKELY(in == in_end)) {
+                return false;
+            }
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (in < in_end) {
+        const unsigned char token = *in++;
+
+        std::size_t literals = token >> 4;
+        if (literals == 15 && !read_length(literals)) {
+            return false;
+        }
+        if (LOGFW_UNLIKELY(literals > std::size_t(in_end - in) || literals > std::size_t(out_end - out))) {
+            return false;
+        }
+        if (LOGFW_LIKELY(std::size_t(in_end - in) >= literals + 8 && std::size_t(out_end - out) >= literals + 8)) {
+            lz_wild_copy(out, in, literals);
+        } else {
+            std::memcpy(out, in, literals);
+        }
+        in += literals;
+        out += literals;
+
+        if (in == in_end) {
+            /* Last sequence */
+            break;
+        }
+
+        if (LOGFW_UNLIKELY(in_end - in < 2)) {
+            return false;
+        }
+        const std::size_t offset = std::size_t(in[0]) | (std::size_t(in[1]) << 8);
+        in += 2;
+        if (LOGFW_UNLIKELY(offset == 0 || offset > std::size_t(out - out_begin))) {
+            return false;
+        }
+
+        std::size_t length = token & 15;
+        if (length == 15 && !read_length(length)) {
+            return false;
+        }
+        length += lz_min_match;
+        if (LOGFW_UNLIKELY(length > std::size_t(out_end - out))) {
+            return false;
+        }
+
+        const unsigned char* match = out - offset;
+        if (LOGFW_LIKELY(offset >= 8 && std::size_t(out_end - out) >= length + 8)) {
+            /* Each step reads bytes written at least 8 bytes before */
+            lz_wild_copy(out, match, length);
+            out += length;
+        } else if (offset >= length) {
+            std::memcpy(out, match, length);
+            out += length;
+        } else {
+            /* Overlapped copy repeats the pattern */
+            for (std::size_t i = 0; i < length; ++i) {
+                *out++ = match[i];
+            }
+        }
+    }
+
+    return out == out_end;
+}
+
+} // namespace logfw::details
+
+#endif /* KSERGEY_lz_171018194612 */
@@ -5,6 +5,8 @@
 #ifndef MADLIFE_meta_291116165708_MADLIFE
 #define MADLIFE_meta_291116165708_MADLIFE
 
+#include <cstddef>
+#include <initializer_list>
 #include <string_view>
 #include <type_traits>
 
@@ -12,157 +14,58 @@
 
 namespace logfw::details {
 
-/* null list type */
-struct null_type
+/**
+ * Fixed capacity string usable in constant expressions.
+ *
+ * Capacity is computed in advance, the string is built by constexpr
+ * functions in a single pass instead of recursive template instantiations.
+ */
+template< std::size_t N >
+class static_string
 {
-    using head = null_type;
-    using tail = null_type;
-};
-
-/* typelist primitive */
-template< class Head, class Tail >
-struct list
-{
-    using head = Head;
-    using tail = Tail;
-};
-
-/* head type from list */
-template< class List >
-using head_type = typename List::head;
-/* tail type from list */
-template< class List >
-using tail_type = typename List::tail;
-
-/* make list implementation  */
-template< class... Args >
-struct make_list_impl;
-template< class Head, class... Rest >
-struct make_list_impl< Head, Rest... >
-{
-    using type = list< Head, typename make_list_impl< Rest... >::type >;
-};
-template<>
-struct make_list_impl<>
-{
-    using type = null_type;
-};
-
-/* make typelist from input Args */
-template< class... Args >
-using make_list = typename make_list_impl< Args... >::type;
-
-/* append type to typelist implementation */
-template< class List, class T >
-struct append_impl;
-template<>
-struct append_impl< null_type, null_type >
-{
-    using type = null_type;
-};
-template< class T >
-struct append_impl< null_type, T >
-{
-    using type = make_list< T >;
-};
-template< class Head, class T >
-struct append_impl< null_type, list< Head, T > >
-{
-    using type = list< Head, T >;
-};
-template< class Head, class Tail, class T >
-struct append_impl< list< Head, Tail >, T >
-{
-    using type = list< Head, typename append_impl< Tail, T >::type >;
-};
-
-/* append type to typelist */
-template< class List, class T >
-using append = typename append_impl< List, T >::type;
+private:
+    /* null-terminated storage */
+    char data_[N + 1] = {};
+    std::size_t size_{0};
 
-/* character class */
-template< char Value >
-struct ch
-    : std::integral_constant< char, Value >
-{};
+public:
+    constexpr static_string() noexcept = default;
 
-/* character list implementation */
-template< char C, char... Chars >
-struct char_list_impl
-{
-    using type = list< ch< C >, typename char_list_impl< Chars... >::type >;
-};
-template< char C >
-struct char_list_impl< C >
-{
-    using type = list< ch< C >, null_type >;
-};
-
-/* typelist of ch< Char > from input character list */
-template< char... Chars >
-using char_list = typename char_list_impl< Chars... >::type;
-
-/* character accessor from char_list implementation */
-template< class Str, std::size_t Pos, char C >
-struct string_list_impl
-{
-    using next_piece = typename string_list_impl< Str, Pos + 1, Str::data()[Pos + 1] >::type;
-    using type = list< ch< C >, next_piece >;
-};
-template< class Str, std::size_t Pos >
-struct string_list_impl< Str, Pos, '\0' >
-{
-    using type = null_type;
-};
-
-/* character accessor from char_list */
-template< class Str >
-using string_list = typename string_list_impl< Str, 0, Str::data()[0] >::type;
-
-/* convert from string type to const char* */
-template< class TypeList, char... Chars >
-struct stringify;
-template< char C, class Rest, char... Chars >
-struct stringify< list< ch< C >, Rest >, Chars... >
-    : stringify< Rest, Chars..., C >
-{};
-template<>
-struct stringify< null_type >
-{
-    static LOGFW_FORCE_INLINE const char* data() noexcept
+    /** Append characters, extra characters are dropped */
+    constexpr void append(std::string_view str) noexcept
     {
-        return "";
+        for (std::size_t i = 0; i < str.size() && size_ < N; ++i) {
+            data_[size_++] = str[i];
+        }
     }
 
-    static LOGFW_FORCE_INLINE constexpr std::size_t size() noexcept
+    /** @return Null-terminated string */
+    constexpr const char* data() const noexcept
     {
-        return 0;
+        return data_;
     }
 
-    static LOGFW_FORCE_INLINE constexpr std::string_view str() noexcept
-    {
-        return {};
-    }
-};
-template< char... Chars >
-struct stringify< null_type, Chars... >
-{
-    static LOGFW_FORCE_INLINE const char* data() noexcept
+    constexpr std::size_t size() const noexcept
     {
-        static constexpr const char str[] = {Chars..., '\0'};
-        return str;
+        return size_;
     }
 
-    static LOGFW_FORCE_INLINE constexpr std::size_t size() noexcept
+    constexpr std::string_view str() const noexcept
     {
-        return sizeof...(Chars);
+        return {data_, size_};
     }
+};
 
-    static LOGFW_FORCE_INLINE std::string_view str() noexcept
-    {
-        return {data(), size()};
+/** @return Concatenation of parts with capacity N */
+template< std::size_t N >
+constexpr static_string< N > make_static_string(std::initializer_list< std::string_view > parts) noexcept
+{
+    static_string< N > result;
+    for (std::string_view part : parts) {
+        result.append(part);
     }
-};
+    return result;
+}
 
 /* some helpers */
 template< class T >
@@ -6,96 +6,284 @@
 #define MADLIFE_type_format_291116174657_MADLIFE
 
 #include <cstdint>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include "meta.hpp"
+#include "user_type_impl.hpp"
 
 namespace logfw::details {
 
-/* Handle compile-time types */
-template< class T >
+/* Compact argument type identity */
+enum class type_tag : std::uint8_t
+{
+    /* Not an argument (literal text) or unknown type */
+    none,
+    i8,
+    u8,
+    i16,
+    u16,
+    i32,
+    u32,
+    i64,
+    u64,
+    c,
+    d,
+    f,
+    s,
+    p,
+    /* logfw::literal */
+    l,
+    /* User type (see user_type) */
+    user,
+    /* Contiguous range of arithmetic values */
+    array
+};
+
+/*
+ * Handle compile-time types.
+ * name - type in format string, tag - runtime type identity
+ */
+template< class T, class Enable = void >
 struct type_format;
 
 template<>
 struct type_format< std::int8_t >
 {
-    using type = char_list< 'i', '8' >;
+    static constexpr std::string_view name = "i8";
+    static constexpr type_tag tag = type_tag::i8;
 };
 template<>
 struct type_format< std::uint8_t >
 {
-    using type = char_list< 'u', '8' >;
+    static constexpr std::string_view name = "u8";
+    static constexpr type_tag tag = type_tag::u8;
 };
 template<>
 struct type_format< std::int16_t >
 {
-    using type = char_list< 'i', '1', '6' >;
+    static constexpr std::string_view name = "i16";
+    static constexpr type_tag tag = type_tag::i16;
 };
 template<>
 struct type_format< std::uint16_t >
 {
-    using type = char_list< 'u', '1', '6' >;
+    static constexpr std::string_view name = "u16";
+    static constexpr type_tag tag = type_tag::u16;
 };
 template<>
 struct type_format< std::int32_t >
 {
-    using type = char_list< 'i', '3', '2' >;
+    static constexpr std::string_view name = "i32";
+    static constexpr type_tag tag = type_tag::i32;
 };
 template<>
 struct type_format< std::uint32_t >
 {
-    using type = char_list< 'u', '3', '2' >;
+    static constexpr std::string_view name = "u32";
+    static constexpr type_tag tag = type_tag::u32;
 };
 template<>
 struct type_format< std::int64_t >
 {
-    using type = char_list< 'i', '6', '4' >;
+    static constexpr std::string_view name = "i64";
+    static constexpr type_tag tag = type_tag::i64;
 };
 template<>
 struct type_format< std::uint64_t >
 {
-    using type = char_list< 'u', '6', '4' >;
+    static constexpr std::string_view name = "u64";
+    static constexpr type_tag tag = type_tag::u64;
 };
 template<>
 struct type_format< char* >
 {
-    using type = char_list< 's' >;
+    static constexpr std::string_view name = "s";
+    static constexpr type_tag tag = type_tag::s;
 };
 template<>
 struct type_format< std::string >
 {
-    using type = char_list< 's' >;
+    static constexpr std::string_view name = "s";
+    static constexpr type_tag tag = type_tag::s;
 };
 template< std::size_t N >
 struct type_format< char[N] >
 {
-    using type = char_list< 's' >;
+    static constexpr std::string_view name = "s";
+    static constexpr type_tag tag = type_tag::s;
 };
 template<>
 struct type_format< std::string_view >
 {
-    using type = char_list< 's' >;
+    static constexpr std::string_view name = "s";
+    static constexpr type_tag tag = type_tag::s;
 };
 template<>
 struct type_format< char >
 {
-    using type = char_list< 'c' >;
+    static constexpr std::string_view name = "c";
+    static constexpr type_tag tag = type_tag::c;
 };
 template<>
 struct type_format< double >
 {
-    using type = char_list< 'd' >;
+    static constexpr std::string_view name = "d";
+    static constexpr type_tag tag = type_tag::d;
 };
 template<>
 struct type_format< float >
 {
-    using type = char_list< 'f' >;
+    static constexpr std::string_view name = "f";
+    static constexpr type_tag tag = type_tag::f;
 };
 template< class T >
 struct type_format< T* >
 {
-    using type = char_list< 'p' >;
+    static constexpr std::string_view name = "p";
+    static constexpr type_tag tag = type_tag::p;
+};
+
+template< class T >
+struct type_format< T, std::enable_if_t< is_user_type_v< T > > >
+{
+    static constexpr std::string_view type_name = user_type< T >::name();
+    /* "@name" */
+    static constexpr auto value = make_static_string< type_name.size() + 1 >({"@", type_name});
+
+    static constexpr std::string_view name = value.str();
+    static constexpr type_tag tag = type_tag::user;
+};
+
+/* Element type of contiguous range */
+template< class T >
+using range_value_t = std::remove_cv_t< std::remove_pointer_t< decltype(std::data(std::declval< const T& >())) > >;
+
+/*
+ * true if T is a contiguous range of arithmetic values (std::vector,
+ * std::array, array_view, ...), strings are not ranges
+ */
+template< class T, class = void >
+struct is_arithmetic_range
+    : std::false_type
+{};
+template< class T >
+struct is_arithmetic_range< T, std::void_t< range_value_t< T >, decltype(std::size(std::declval< const T& >())) > >
+    : std::bool_constant<
+        std::is_arithmetic_v< range_value_t< T > >
+        && !std::is_same_v< range_value_t< T >, bool >
+        && !std::is_convertible_v< const T&, std::string_view >
+        && !is_user_type_v< T >
+    >
+{};
+
+template< class T >
+constexpr bool is_arithmetic_range_v = is_arithmetic_range< T >::value;
+
+template< class T >
+struct type_format< T, std::enable_if_t< is_arithmetic_range_v< T > > >
+{
+    using element = type_format< range_value_t< T > >;
+
+    /* "[element]" */
+    static constexpr auto value = make_static_string< element::name.size() + 2 >({"[", element::name, "]"});
+
+    static constexpr std::string_view name = value.str();
+    static constexpr type_tag tag = type_tag::array;
 };
 
+/* @return true for tags of arithmetic types (array elements) */
+constexpr bool is_arithmetic_tag(type_tag tag) noexcept
+{
+    return tag >= type_tag::i8 && tag <= type_tag::f;
+}
+
+/* @return Encoded size of arithmetic type of tag with fixed_encoding */
+constexpr std::size_t tag_size(type_tag tag) noexcept
+{
+    switch (tag) {
+        case type_tag::i8:
+        case type_tag::u8:
+        case type_tag::c:
+            return 1;
+        case type_tag::i16:
+        case type_tag::u16:
+            return 2;
+        case type_tag::i32:
+        case type_tag::u32:
+        case type_tag::f:
+            return 4;
+        case type_tag::i64:
+        case type_tag::u64:
+        case type_tag::d:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+/* Runtime type string to tag conversion, constant cost */
+constexpr type_tag parse_type_tag(std::string_view type) noexcept
+{
+    if (type.size() > 1 && type[0] == '@') {
+        return type_tag::user;
+    }
+    if (type.size() > 2 && type[0] == '[' && type.back() == ']') {
+        /* Only arithmetic elements are allowed */
+        return is_arithmetic_tag(parse_type_tag(type.substr(1, type.size() - 2)))
+            ? type_tag::array : type_tag::none;
+    }
+
+    if (type.size() == 1) {
+        switch (type[0]) {
+            case 'c': return type_tag::c;
+            case 'd': return type_tag::d;
+            case 'f': return type_tag::f;
+            case 's': return type_tag::s;
+            case 'p': return type_tag::p;
+            case 'l': return type_tag::l;
+            default: return type_tag::none;
+        }
+    }
+
+    if (type.size() < 2 || (type[0] != 'i' && type[0] != 'u')) {
+        return type_tag::none;
+    }
+
+    const bool is_signed = type[0] == 'i';
+    const std::string_view bits = type.substr(1);
+    if (bits == "8") {
+        return is_signed ? type_tag::i8 : type_tag::u8;
+    } else if (bits == "16") {
+        return is_signed ? type_tag::i16 : type_tag::u16;
+    } else if (bits == "32") {
+        return is_signed ? type_tag::i32 : type_tag::u32;
+    } else if (bits == "64") {
+        return is_signed ? type_tag::i64 : type_tag::u64;
+    }
+
+    return type_tag::none;
+}
+
+/* @return Element type tag of array type string ("[type]") */
+constexpr type_tag parse_element_tag(std::string_view type) noexcept
+{
+    return type.size() > 2 ? parse_type_tag(type.substr(1, type.size() - 2)) : type_tag::none;
+}
+
+/* @return Element type tag of range or type_tag::none for other types */
+template< class T >
+constexpr type_tag element_tag_of() noexcept
+{
+    if constexpr (is_arithmetic_range_v< T >) {
+        return type_format< range_value_t< T > >::tag;
+    } else {
+        return type_tag::none;
+    }
+}
+
 } // namespace logfw::details
 
 #endif /* MADLIFE_type_format_291116174657_MADLIFE */
@@ -0,0 +1,167 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_user_type_impl_121018173321
+#define KSERGEY_user_type_impl_121018173321
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "../compiler.hpp"
+#include "meta.hpp"
+
+namespace logfw {
+
+class buffer;
+
+/**
+ * Customization point for user types, see user_type.hpp.
+ * Not defined for other types.
+ */
+template< class T >
+struct user_type;
+
+} /* namespace logfw */
+
+namespace logfw::details {
+
+struct format_spec;
+
+/* true if T is a user type (user_type< T > is specialized) */
+template< class T, class = void >
+struct is_user_type
+    : std::false_type
+{};
+template< class T >
+struct is_user_type< T, std::void_t< decltype(user_type< T >::name()) > >
+    : std::true_type
+{};
+
+template< class T >
+constexpr bool is_user_type_v = is_user_type< T >::value;
+
+/* Encoded representation, user_type< T >::encoded_type or T */
+template< class T, class = void >
+struct user_encoded_type
+{
+    using type = T;
+};
+template< class T >
+struct user_encoded_type< T, std::void_t< typename user_type< T >::encoded_type > >
+{
+    using type = typename user_type< T >::encoded_type;
+};
+
+template< class T >
+using user_encoded_type_t = typename user_encoded_type< T >::type;
+
+/* Convert value to encoded representation */
+template< class T >
+LOGFW_FORCE_INLINE decltype(auto) user_encode(const T& value)
+{
+    if constexpr (std::is_same_v< user_encoded_type_t< T >, T >) {
+        return (value);
+    } else {
+        return user_type< T >::encode(value);
+    }
+}
+
+/** Runtime description of a user type */
+struct user_type_info
+{
+    /* Type name (format string type is '@' + name) */
+    std::string_view name;
+    /* Encoded size */
+    std::size_t size;
+    /* Render encoded value */
+    void (*format)(buffer& buf, const format_spec& spec, const char* data);
+};
+
+/** Known user types, for formats parsed at runtime */
+class user_type_registry
+{
+private:
+    mutable std::mutex mutex_;
+    std::vector< const user_type_info* > types_;
+
+    user_type_registry() = default;
+
+public:
+    user_type_registry(const user_type_registry&) = delete;
+    user_type_registry& operator=(const user_type_registry&) = delete;
+
+    /** @return Global registry */
+    static user_type_registry& instance()
+    {
+        static user_type_registry registry;
+        return registry;
+    }
+
+    /** Register user type, types with the same name are replaced */
+    bool add(const user_type_info* info)
+    {
+        std::lock_guard< std::mutex > lock{mutex_};
+        for (auto& type: types_) {
+            if (type->name == info->name) {
+                type = info;
+                return true;
+            }
+        }
+        types_.push_back(info);
+        return true;
+    }
+
+    /** @return User type by name or nullptr */
+    const user_type_info* find(std::string_view name) const
+    {
+        std::lock_guard< std::mutex > lock{mutex_};
+        for (const auto& type: types_) {
+            if (type->name == name) {
+                return type;
+            }
+        }
+        return nullptr;
+    }
+};
+
+/* User type description, registered during static initialization once used */
+template< class T >
+struct user_type_entry
+{
+    using encoded_type = user_encoded_type_t< T >;
+
+    static_assert( std::is_trivially_copyable_v< encoded_type >,
+            "User type encoded representation should be trivially copyable" );
+
+    static constexpr user_type_info value = {
+        user_type< T >::name(),
+        sizeof(encoded_type),
+        [](buffer& buf, const format_spec& spec, const char* data) {
+            encoded_type encoded;
+            std::memcpy(&encoded, data, sizeof(encoded));
+            user_type< T >::format(buf, spec, encoded);
+        }
+    };
+
+    static inline const bool registered = user_type_registry::instance().add(&value);
+};
+
+/* @return User type description or nullptr for other types */
+template< class T >
+constexpr const user_type_info* user_type_of() noexcept
+{
+    if constexpr (is_user_type_v< T >) {
+        return &user_type_entry< T >::value;
+    } else {
+        return nullptr;
+    }
+}
+
+} // namespace logfw::details
+
+#endif /* KSERGEY_user_type_impl_121018173321 */
@@ -0,0 +1,88 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_varint_121018101544
+#define KSERGEY_varint_121018101544
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "../compiler.hpp"
+
+namespace logfw::details {
+
+/* Max bytes of LEB128 encoded 64-bit value */
+static constexpr std::size_t varint_max_size = 10;
+
+/** @return Bytes required to store value as LEB128 */
+constexpr std::size_t varint_size(std::uint64_t value) noexcept
+{
+    std::size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+/**
+ * Store value as LEB128 (7 bits per byte, least significant first).
+ * @return Used bytes
+ */
+LOGFW_FORCE_INLINE std::size_t encode_varint(std::uint64_t value, char* buffer) noexcept
+{
+    std::size_t size = 0;
+    while (value >= 0x80) {
+        buffer[size++] = static_cast< char >(value | 0x80);
+        value >>= 7;
+    }
+    buffer[size++] = static_cast< char >(value);
+    return size;
+}
+
+/**
+ * Load LEB128 value.
+ * @return Used bytes
+ * @throw std::runtime_error if buffer is too small or value is too long
+ */
+LOGFW_FORCE_INLINE std::size_t decode_varint(std::uint64_t& value, const char* buffer, std::size_t size)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (LOGFW_LIKELY(size >= 8)) {
+        /* Values up to 8 bytes (56 bits) are decoded without loop */
+        std::uint64_t word;
+        std::memcpy(&word, buffer, sizeof(word));
+
+        /* Bit 7 of each last byte of a value */
+        const std::uint64_t stop = ~word & 0x8080808080808080ull;
+        if (LOGFW_LIKELY(stop != 0)) {
+            /* Drop bytes after the last one and continuation bits */
+            word &= (stop ^ (stop - 1)) & 0x7f7f7f7f7f7f7f7full;
+
+            /* Squeeze 7-bit groups together */
+            word = ((word & 0x7f007f007f007f00ull) >> 1) | (word & 0x007f007f007f007full);
+            word = ((word & 0x3fff00003fff0000ull) >> 2) | (word & 0x00003fff00003fffull);
+            word = ((word & 0x0fffffff00000000ull) >> 4) | (word & 0x000000000fffffffull);
+
+            value = word;
+            return (__builtin_ctzll(stop) >> 3) + 1;
+        }
+    }
+#endif
+
+    value = 0;
+    for (std::size_t i = 0; i < size && i < varint_max_size; ++i) {
+        const auto byte = static_cast< std::uint8_t >(buffer[i]);
+        value |= std::uint64_t(byte & 0x7f) << (7 * i);
+        if ((byte & 0x80) == 0) {
+            return i + 1;
+        }
+    }
+    throw std::runtime_error(size < varint_max_size ? "Buffer too small" : "Invalid varint");
+}
+
+} // namespace logfw::details
+
+#endif /* KSERGEY_varint_121018101544 */
@@ -5,8 +5,11 @@
 #ifndef MADLIFE_write_impl_031216001659_MADLIFE
 #define MADLIFE_write_impl_031216001659_MADLIFE
 
+#include <cstdint>
 #include <iomanip>
+#include "../buffer.hpp"
 #include "../decoder.hpp"
+#include "literal_impl.hpp"
 
 namespace logfw::details {
 
@@ -17,27 +20,51 @@ constexpr bool next_is(std::string_view str, std::size_t index)
     return index < str.size() ? str[index] == Ch : false;
 }
 
-LOGFW_FORCE_INLINE void apply_format_flags(std::ostream& os, std::string_view flags)
+/* Pre-parsed formatting flags, i.e. <flags><width>.<precision> */
+struct format_spec
+{
+    /* '0' flag, pad with zeros */
+    bool zero{false};
+    /* '-' flag, left alignment */
+    bool left{false};
+    /* '+' flag, show sign */
+    bool plus{false};
+    /* 'x' flag, hex output */
+    bool hex{false};
+    /* Field width, zero if not set */
+    std::uint32_t width{0};
+    /* Precision, zero if not set */
+    std::uint32_t precision{0};
+};
+
+constexpr bool is_digit(char ch) noexcept
+{
+    return ch >= '0' && ch <= '9';
+}
+
+constexpr format_spec parse_format_spec(std::string_view flags) noexcept
 {
+    format_spec spec;
+
     std::size_t idx = 0;
     while (idx < flags.size()) {
         if (flags[idx] == '0') {
-            os.fill('0');
+            spec.zero = true;
         } else if (flags[idx] == '-') {
-            os << std::left;
+            spec.left = true;
         } else if (flags[idx] == '+') {
-            os << std::showpos;
+            spec.plus = true;
         } else if (flags[idx] == 'x') {
-            os << std::hex;
+            spec.hex = true;
         } else {
             break;
         }
         ++idx;
     }
 
-    std::size_t width{0};
+    std::uint32_t width{0};
     while (idx < flags.size()) {
-        if (std::isdigit(flags[idx])) {
+        if (is_digit(flags[idx])) {
             width = width * 10 + (flags[idx] - '0');
             ++idx;
         } else if (flags[idx] == '.') {
@@ -45,98 +72,259 @@ LOGFW_FORCE_INLINE void apply_format_flags(std::ostream& os, std::string_view fl
             break;
         } else {
             /* what to do? */
-            return ;
+            return spec;
         }
     }
 
-    std::size_t precision{0};
+    std::uint32_t precision{0};
     while (idx < flags.size()) {
-        if (std::isdigit(flags[idx])) {
+        if (is_digit(flags[idx])) {
             precision = precision * 10 + (flags[idx] - '0');
             ++idx;
         } else {
             /* What to do? */
-            return ;
+            return spec;
         }
     }
 
-    if (width > 0) {
-        os << std::setw(width);
+    spec.width = width;
+    spec.precision = precision;
+
+    return spec;
+}
+
+LOGFW_FORCE_INLINE void apply_format_spec(std::ostream& os, const format_spec& spec)
+{
+    if (spec.zero) {
+        os.fill('0');
+    }
+    if (spec.left) {
+        os << std::left;
+    }
+    if (spec.plus) {
+        os << std::showpos;
+    }
+    if (spec.hex) {
+        os << std::hex;
     }
 
-    if (precision > 0) {
-        os << std::fixed << std::setprecision(precision);
+    if (spec.width > 0) {
+        os << std::setw(spec.width);
+    }
+
+    if (spec.precision > 0) {
+        os << std::fixed << std::setprecision(spec.precision);
     }
 }
 
+LOGFW_FORCE_INLINE void apply_format_flags(std::ostream& os, std::string_view flags)
+{
+    apply_format_spec(os, parse_format_spec(flags));
+}
 
 template< class T >
-struct write_if_match_impl
+LOGFW_FORCE_INLINE void write_formatted(std::ostream& os, const format_spec& spec, const T& value)
 {
-    LOGFW_FORCE_INLINE static bool run(std::ostream& os, std::string_view type, std::string_view flags, decoder& d)
-    {
-        if (!d.is< T >(type)) {
-            return false;
-        }
+    /* Save ostream flags */
+    std::ios state{nullptr};
+    state.copyfmt(os);
 
-        /* Decode value */
-        T value;
-        d.decode(value);
-
-        /* Save ostream flags */
-        std::ios state{nullptr};
-        state.copyfmt(os);
-
-        /* Apply formating flags to ostream */
-        apply_format_flags(os, flags);
+    /* Apply formating flags to ostream */
+    apply_format_spec(os, spec);
 
-        /* Write value */
-        os << value;
+    /* Write value */
+    os << value;
 
-        /* Restore ostream formating flags */
-        os.copyfmt(state);
+    /* Restore ostream formating flags */
+    os.copyfmt(state);
+}
 
-        return true;
+/* Decode and write argument */
+template< class T >
+struct value_writer
+{
+    template< class Decoder >
+    static void run(std::ostream& os, const format_spec& spec, Decoder& d)
+    {
+        T value;
+        d.decode(value);
+        write_formatted(os, spec, value);
     }
 };
 
 template< class T >
-struct write_if_match_impl< T* >
+struct value_writer< T* >
+{
+    template< class Decoder >
+    static void run(std::ostream& os, const format_spec& spec, Decoder& d)
+    {
+        void* value;
+        d.decode(value);
+        write_formatted(os, spec, value);
+    }
+};
+
+template<>
+struct value_writer< std::string_view >
 {
-    LOGFW_FORCE_INLINE static bool run(std::ostream& os, std::string_view type, std::string_view flags, decoder& d)
+    template< class Decoder >
+    static void run(std::ostream& os, const format_spec& spec, Decoder& d)
     {
-        if (!d.is< T* >(type)) {
-            return false;
+        string_arg value;
+        d.decode(value);
+        write_formatted(os, spec, value.value);
+        if (LOGFW_UNLIKELY(value.truncated)) {
+            os << truncation_marker;
         }
+    }
+};
 
-        /* Decode value */
-        void* value;
+template<>
+struct value_writer< literal >
+{
+    template< class Decoder >
+    static void run(std::ostream& os, const format_spec& spec, Decoder& d)
+    {
+        literal value;
         d.decode(value);
+        write_formatted(os, spec, find_literal(value));
+    }
+};
 
-        /* Save ostream flags */
-        std::ios state{nullptr};
-        state.copyfmt(os);
+/* Decode and write user type argument */
+template< class Decoder >
+LOGFW_FORCE_INLINE void write_user_arg(buffer& buf, const user_type_info& info, const format_spec& spec, Decoder& d)
+{
+    info.format(buf, spec, d.take(info.size));
+}
 
-        /* Apply formating flags to ostream */
-        apply_format_flags(os, flags);
+/* Scratch buffer of the rendering thread for user types written into std::ostream */
+inline buffer& local_user_arg_buffer()
+{
+    static thread_local buffer buf{256};
+    return buf;
+}
 
-        /* Write value */
-        os << value;
+template< class Decoder >
+inline void write_user_arg(std::ostream& os, const user_type_info& info, const format_spec& spec, Decoder& d)
+{
+    buffer& buf = local_user_arg_buffer();
+    buf.clear();
+    write_user_arg(buf, info, spec, d);
+    os.write(buf.data(), buf.size());
+}
 
-        /* Restore ostream formating flags */
-        os.copyfmt(state);
+/**
+ * @return User type of format type string ('@' + name)
+ * @throw std::runtime_error if the type is not registered
+ */
+inline const user_type_info& find_user_type(std::string_view type)
+{
+    const user_type_info* info = user_type_registry::instance().find(type.substr(1));
+    if (LOGFW_UNLIKELY(!info)) {
+        throw std::runtime_error("Unknown user type");
+    }
+    return *info;
+}
 
-        return true;
+/**
+ * Call Writer<T>::run for type of tag.
+ * Compiles into a jump table, cost doesn't depend on the type.
+ */
+template< template< class > class Writer, class Output, class Decoder >
+LOGFW_FORCE_INLINE void dispatch_writer(type_tag tag, Output& out, const format_spec& spec, Decoder& d)
+{
+    switch (tag) {
+        case type_tag::i8:
+            Writer< std::int8_t >::run(out, spec, d);
+            break;
+        case type_tag::u8:
+            Writer< std::uint8_t >::run(out, spec, d);
+            break;
+        case type_tag::i16:
+            Writer< std::int16_t >::run(out, spec, d);
+            break;
+        case type_tag::u16:
+            Writer< std::uint16_t >::run(out, spec, d);
+            break;
+        case type_tag::i32:
+            Writer< std::int32_t >::run(out, spec, d);
+            break;
+        case type_tag::u32:
+            Writer< std::uint32_t >::run(out, spec, d);
+            break;
+        case type_tag::i64:
+            Writer< std::int64_t >::run(out, spec, d);
+            break;
+        case type_tag::u64:
+            Writer< std::uint64_t >::run(out, spec, d);
+            break;
+        case type_tag::c:
+            Writer< char >::run(out, spec, d);
+            break;
+        case type_tag::d:
+            Writer< double >::run(out, spec, d);
+            break;
+        case type_tag::f:
+            Writer< float >::run(out, spec, d);
+            break;
+        case type_tag::s:
+            Writer< std::string_view >::run(out, spec, d);
+            break;
+        case type_tag::p:
+            Writer< void* >::run(out, spec, d);
+            break;
+        case type_tag::l:
+            Writer< literal >::run(out, spec, d);
+            break;
+        default:
+            throw std::runtime_error("Unknown format type");
     }
-};
+}
 
-template< class T >
-LOGFW_FORCE_INLINE bool write_if_match(std::ostream& os, std::string_view type, std::string_view flags, decoder& d)
+LOGFW_FORCE_INLINE void write_text(std::ostream& os, std::string_view text)
+{
+    os.write(text.data(), text.size());
+}
+
+LOGFW_FORCE_INLINE void write_text(buffer& buf, std::string_view text)
+{
+    buf.append(text);
+}
+
+/**
+ * Decode array argument and write it as "[a, b, c]", formatting flags are
+ * applied to each element. Truncated array ends with ", ...".
+ */
+template< template< class > class Writer, class Output, class Decoder >
+inline void write_array(type_tag element, Output& out, const format_spec& spec, Decoder& d)
 {
-    return write_if_match_impl< T >::run(os, type, flags, d);
+    if (LOGFW_UNLIKELY(!is_arithmetic_tag(element))) {
+        throw std::runtime_error("Unknown array element type");
+    }
+
+    array_arg header;
+    d.decode(header);
+
+    /* Elements are fixed-width with any encoding */
+    const std::size_t size = header.count * tag_size(element);
+    decoder elements{d.take(size), size};
+
+    write_text(out, "[");
+    for (std::size_t i = 0; i < header.count; ++i) {
+        if (i > 0) {
+            write_text(out, ", ");
+        }
+        dispatch_writer< Writer >(element, out, spec, elements);
+    }
+    if (LOGFW_UNLIKELY(header.truncated)) {
+        write_text(out, header.count > 0 ? ", ..." : "...");
+    }
+    write_text(out, "]");
 }
 
-LOGFW_FORCE_INLINE void write_arg(std::ostream& os, std::string_view spec, decoder& d)
+template< class Decoder >
+LOGFW_FORCE_INLINE void write_arg(std::ostream& os, std::string_view spec, Decoder& d)
 {
     /* find type:spec delimiter */
     auto found = spec.find(':');
@@ -150,24 +338,17 @@ LOGFW_FORCE_INLINE void write_arg(std::ostream& os, std::string_view spec, decod
         flags = spec.substr(found + 1);
     }
 
-    bool printed =
-        write_if_match< std::int8_t >(os, type, flags, d) ||
-        write_if_match< std::uint8_t >(os, type, flags, d) ||
-        write_if_match< std::int16_t >(os, type, flags, d) ||
-        write_if_match< std::uint16_t >(os, type, flags, d) ||
-        write_if_match< std::int32_t >(os, type, flags, d) ||
-        write_if_match< std::uint32_t >(os, type, flags, d) ||
-        write_if_match< std::int64_t >(os, type, flags, d) ||
-        write_if_match< std::uint64_t >(os, type, flags, d) ||
-        write_if_match< char >(os, type, flags, d) ||
-        write_if_match< double >(os, type, flags, d) ||
-        write_if_match< float >(os, type, flags, d) ||
-        write_if_match< std::string_view >(os, type, flags, d) ||
-        write_if_match< void* >(os, type, flags, d);
-
-    if (LOGFW_UNLIKELY(!printed)) {
-        throw std::runtime_error("Unknown format type");
+    const type_tag tag = parse_type_tag(type);
+    if (LOGFW_UNLIKELY(tag == type_tag::user)) {
+        write_user_arg(os, find_user_type(type), parse_format_spec(flags), d);
+        return;
     }
+    if (LOGFW_UNLIKELY(tag == type_tag::array)) {
+        write_array< value_writer >(parse_element_tag(type), os, parse_format_spec(flags), d);
+        return;
+    }
+
+    dispatch_writer< value_writer >(tag, os, parse_format_spec(flags), d);
 }
 
 } // namespace logfw::details
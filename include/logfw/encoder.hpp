@@ -5,12 +5,33 @@
 #ifndef MADLIFE_encoder_291116183743_MADLIFE
 #define MADLIFE_encoder_291116183743_MADLIFE
 
+#include <cstdint>
+#include <stdexcept>
+
+#include "compiler.hpp"
 #include "details/encode_impl.hpp"
 
+/* Record encodings */
+#define LOGFW_ENCODING_FIXED 0
+#define LOGFW_ENCODING_COMPACT 1
+
+/* Compile-time choice of record args encoding (see compact_encoding) */
+#ifndef LOGFW_ENCODING
+#   define LOGFW_ENCODING LOGFW_ENCODING_FIXED
+#endif
+
 namespace logfw {
 
+/** Writable memory block */
+struct byte_span
+{
+    char* data{nullptr};
+    std::size_t size{0};
+};
+
 /** Compile-time args encoder */
-struct encoder
+template< class Policy >
+struct basic_encoder
 {
     /**
      * Encode args into buffer
@@ -19,7 +40,24 @@ struct encoder
     template< class... Args >
     LOGFW_FORCE_INLINE static std::size_t encode(char* buffer, const Args&... args)
     {
-        return details::encode_impl< Args... >::encode(args..., buffer);
+        return details::encode_impl_t< Policy, Args... >::encode(args..., buffer);
+    }
+
+    /**
+     * Encode args into bounded buffer.
+     * Exact size is calculated only if the worst case doesn't fit (long strings).
+     * @return bytes used
+     * @throw std::length_error if args don't fit
+     */
+    template< class... Args >
+    LOGFW_FORCE_INLINE static std::size_t encode(byte_span buffer, const Args&... args)
+    {
+        if (LOGFW_UNLIKELY(max_bytes_required< Args... >() > buffer.size)) {
+            if (bytes_required(args...) > buffer.size) {
+                throw std::length_error("Buffer too small");
+            }
+        }
+        return encode(buffer.data, args...);
     }
 
     /**
@@ -29,7 +67,17 @@ struct encoder
     template< class... Args >
     LOGFW_FORCE_INLINE static constexpr std::size_t max_bytes_required()
     {
-        return details::encode_impl< Args... >::max_bytes_required();
+        return details::encode_impl_t< Policy, Args... >::max_bytes_required();
+    }
+
+    /**
+     * @return true if args contain strings or arrays, i.e. max_bytes_required()
+     *      is far from the usual size and the actual size should be calculated
+     */
+    template< class... Args >
+    LOGFW_FORCE_INLINE static constexpr bool variable_size()
+    {
+        return (details::has_variable_size< typename Policy::template io< Args > >::value || ...);
     }
 
     /**
@@ -39,10 +87,27 @@ struct encoder
     template< class... Args >
     LOGFW_FORCE_INLINE static constexpr std::size_t bytes_required(const Args&... args)
     {
-        return details::encode_impl< Args... >::bytes_required(args...);
+        return details::encode_impl_t< Policy, Args... >::bytes_required(args...);
     }
 };
 
+/** Encoder with fixed-width arithmetic args */
+using encoder = basic_encoder< fixed_encoding >;
+
+#if LOGFW_ENCODING == LOGFW_ENCODING_FIXED
+using record_encoding = fixed_encoding;
+#elif LOGFW_ENCODING == LOGFW_ENCODING_COMPACT
+using record_encoding = compact_encoding;
+#else
+#   error "Unknown LOGFW_ENCODING"
+#endif
+
+/** Record args encoding id (stored in binary logs and shared memory) */
+static constexpr std::uint32_t record_encoding_id = LOGFW_ENCODING;
+
+/** Encoder of records */
+using record_encoder = basic_encoder< record_encoding >;
+
 } /* namespace logfw */
 
 #endif /* MADLIFE_encoder_291116183743_MADLIFE */
@@ -0,0 +1,251 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_file_sink_171018171533
+#define KSERGEY_file_sink_171018171533
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "compiler.hpp"
+#include "sink.hpp"
+
+namespace logfw {
+
+/** When file_sink syncs written data to disk */
+enum class fsync_policy
+{
+    /* Leave it to the OS */
+    never,
+    /* Every fsync_interval if anything was written */
+    interval,
+    /* After each fsync_bytes of written data */
+    bytes
+};
+
+/** File sink settings */
+struct file_sink_options
+{
+    /* Append to existing file instead of truncating it */
+    bool append = false;
+    /* Buffer chunk size in bytes, each chunk is a single iovec */
+    std::size_t chunk_size = 64 * 1024;
+    /* Buffered bytes which are written before flush() */
+    std::size_t buffer_size = 1024 * 1024;
+    /* Sync policy, syncs are done by a helper thread */
+    fsync_policy fsync = fsync_policy::never;
+    /* Sync interval in interval mode */
+    std::chrono::milliseconds fsync_interval{1000};
+    /* Written bytes between syncs in bytes mode */
+    std::size_t fsync_bytes = 16 * 1024 * 1024;
+};
+
+/**
+ * Text file sink.
+ *
+ * Rendered records of a batch are copied into chunks and written with a
+ * single writev() on flush(). fdatasync() is done by a helper thread
+ * according to fsync_policy, so backend thread never waits for the disk.
+ */
+class file_sink final
+    : public sink
+{
+private:
+    struct chunk
+    {
+        std::unique_ptr< char[] > data;
+        std::size_t size{0};
+    };
+
+    int fd_{-1};
+    file_sink_options options_;
+
+    /* Chunks [0, used_) hold buffered records, others are kept for reuse */
+    std::vector< chunk > chunks_;
+    std::size_t used_{0};
+    /* Buffered bytes */
+    std::size_t size_{0};
+    std::vector< iovec > iov_;
+
+    /* Sync thread state */
+    std::thread sync_thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_{false};
+    bool sync_requested_{false};
+    /* Bytes written since the last sync */
+    std::atomic< std::uint64_t > unsynced_{0};
+
+public:
+    /**
+     * Open file.
+     * @throw std::runtime_error on i/o error
+     */
+    explicit file_sink(const std::string& path, file_sink_options options = {})
+        : options_(options)
+    {
+        if (options_.chunk_size == 0) {
+            throw std::invalid_argument("File sink chunk size should be positive");
+        }
+
+        const int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (options_.append ? O_APPEND : O_TRUNC);
+        fd_ = ::open(path.c_str(), flags, 0644);
+        if (fd_ < 0) {
+            throw std::runtime_error("Failed to open \"" + path + "\": " + std::strerror(errno));
+        }
+
+        if (options_.fsync != fsync_policy::never) {
+            sync_thread_ = std::thread([this] {
+                sync_loop();
+            });
+        }
+    }
+
+    file_sink(const file_sink&) = delete;
+    file_sink& operator=(const file_sink&) = delete;
+
+    ~file_sink() override
+    {
+        flush();
+
+        if (sync_thread_.joinable()) {
+            {
+                std::lock_guard< std::mutex > lock{mutex_};
+                stop_ = true;
+            }
+            cv_.notify_one();
+            sync_thread_.join();
+            ::fdatasync(fd_);
+        }
+
+        ::close(fd_);
+    }
+
+    void write(std::string_view record) override
+    {
+        while (!record.empty()) {
+            if (used_ == 0 || chunks_[used_ - 1].size == options_.chunk_size) {
+                next_chunk();
+            }
+            chunk& last = chunks_[used_ - 1];
+            const std::size_t count = std::min(record.size(), options_.chunk_size - last.size);
+            std::memcpy(last.data.get() + last.size, record.data(), count);
+            last.size += count;
+            size_ += count;
+            record.remove_prefix(count);
+        }
+
+        if (LOGFW_UNLIKELY(size_ >= options_.buffer_size)) {
+            flush();
+        }
+    }
+
+    void flush() override
+    {
+        if (size_ == 0) {
+            return;
+        }
+
+        iov_.clear();
+        for (std::size_t i = 0; i < used_; ++i) {
+            iov_.push_back({chunks_[i].data.get(), chunks_[i].size});
+            chunks_[i].size = 0;
+        }
+        write_all();
+
+        const std::uint64_t written = size_;
+        used_ = 0;
+        size_ = 0;
+
+        if (options_.fsync != fsync_policy::never) {
+            const std::uint64_t unsynced = unsynced_.fetch_add(written, std::memory_order_relaxed) + written;
+            if (options_.fsync == fsync_policy::bytes && unsynced >= options_.fsync_bytes) {
+                {
+                    std::lock_guard< std::mutex > lock{mutex_};
+                    sync_requested_ = true;
+                }
+                cv_.notify_one();
+            }
+        }
+    }
+
+private:
+    void next_chunk()
+    {
+        if (used_ == chunks_.size()) {
+            chunks_.push_back({std::unique_ptr< char[] >(new char[options_.chunk_size]), 0});
+        }
+        ++used_;
+    }
+
+    /* Write iov_ with as few writev() calls as possible */
+    void write_all() noexcept
+    {
+        std::size_t index = 0;
+        while (index < iov_.size()) {
+            const int count = static_cast< int >(std::min< std::size_t >(iov_.size() - index, IOV_MAX));
+            const ssize_t rc = ::writev(fd_, &iov_[index], count);
+            if (rc < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                /* Nowhere to report, drop data */
+                break;
+            }
+
+            /* Skip written iovecs, adjust partially written one */
+            std::size_t written = rc;
+            while (index < iov_.size() && written >= iov_[index].iov_len) {
+                written -= iov_[index].iov_len;
+                ++index;
+            }
+            if (written > 0) {
+                iov_[index].iov_base = static_cast< char* >(iov_[index].iov_base) + written;
+                iov_[index].iov_len -= written;
+            }
+        }
+    }
+
+    void sync_loop()
+    {
+        std::unique_lock< std::mutex > lock{mutex_};
+        while (!stop_) {
+            if (options_.fsync == fsync_policy::interval) {
+                cv_.wait_for(lock, options_.fsync_interval, [this] {
+                    return stop_;
+                });
+            } else {
+                cv_.wait(lock, [this] {
+                    return stop_ || sync_requested_;
+                });
+            }
+            sync_requested_ = false;
+
+            if (unsynced_.exchange(0, std::memory_order_relaxed) > 0) {
+                lock.unlock();
+                ::fdatasync(fd_);
+                lock.lock();
+            }
+        }
+    }
+};
+
+} /* namespace logfw */
+
+#endif /* KSERGEY_file_sink_171018171533 */
@@ -0,0 +1,203 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_format_program_051018102214
+#define KSERGEY_format_program_051018102214
+
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer.hpp"
+#include "compiler.hpp"
+#include "decoder.hpp"
+#include "details/format_parser.hpp"
+#include "details/write_impl.hpp"
+
+namespace logfw {
+
+namespace details {
+
+/* Serialize encoded args into ostream according to compiled format */
+template< class Policy = fixed_encoding >
+LOGFW_FORCE_INLINE void run_format_ops(std::ostream& os, const char* fmt, const format_op* ops, std::size_t count,
+        const char* buffer, std::size_t size)
+{
+    basic_decoder< Policy > dec{buffer, size};
+
+    for (const format_op* o = ops; o != ops + count; ++o) {
+        if (LOGFW_UNLIKELY(o->tag == type_tag::user)) {
+            write_user_arg(os, *o->user, o->spec, dec);
+        } else if (LOGFW_UNLIKELY(o->tag == type_tag::array)) {
+            write_array< value_writer >(o->element, os, o->spec, dec);
+        } else if (o->tag != type_tag::none) {
+            dispatch_writer< value_writer >(o->tag, os, o->spec, dec);
+        } else {
+            os.write(fmt + o->offset, o->size);
+        }
+    }
+}
+
+/* Serialize encoded args into buffer according to compiled format */
+template< class Policy = fixed_encoding >
+LOGFW_FORCE_INLINE void run_format_ops(buffer& buf, const char* fmt, const format_op* ops, std::size_t count,
+        const char* buffer, std::size_t size)
+{
+    basic_decoder< Policy > dec{buffer, size};
+
+    for (const format_op* o = ops; o != ops + count; ++o) {
+        if (LOGFW_UNLIKELY(o->tag == type_tag::user)) {
+            write_user_arg(buf, *o->user, o->spec, dec);
+        } else if (LOGFW_UNLIKELY(o->tag == type_tag::array)) {
+            write_array< buffer_value_writer >(o->element, buf, o->spec, dec);
+        } else if (o->tag != type_tag::none) {
+            dispatch_writer< buffer_value_writer >(o->tag, buf, o->spec, dec);
+        } else {
+            buf.append(fmt + o->offset, o->size);
+        }
+    }
+}
+
+} // namespace details
+
+/**
+ * Format string compiled into a list of operations.
+ *
+ * Format is parsed once, each operation is either a literal text span or
+ * an argument writer with pre-parsed formatting flags. Output is the same
+ * as of logfw::write.
+ */
+class format_program
+{
+public:
+    /** Program operation */
+    using op = details::format_op;
+
+private:
+    /* Parser handler, builds operations */
+    struct compiler
+    {
+        std::vector< op >& ops;
+
+        void literal(std::size_t offset, std::size_t size)
+        {
+            op o;
+            o.offset = static_cast< std::uint32_t >(offset);
+            o.size = static_cast< std::uint32_t >(size);
+            ops.push_back(o);
+        }
+
+        void arg(std::string_view type, std::string_view flags)
+        {
+            op o;
+            o.tag = details::parse_type_tag(type);
+            if (LOGFW_UNLIKELY(o.tag == details::type_tag::none)) {
+                throw std::runtime_error("Unknown format type");
+            }
+            if (o.tag == details::type_tag::user) {
+                o.user = &details::find_user_type(type);
+            } else if (o.tag == details::type_tag::array) {
+                o.element = details::parse_element_tag(type);
+            }
+            o.spec = details::parse_format_spec(flags);
+            ops.push_back(o);
+        }
+    };
+
+    std::string format_;
+    std::vector< op > ops_;
+
+public:
+    /**
+     * Compile format string.
+     * @throw std::runtime_error on format error
+     */
+    explicit format_program(std::string_view fmt)
+        : format_(fmt)
+    {
+        compiler c{ops_};
+        details::parse_format(format_, c);
+    }
+
+    /** @return Format string */
+    std::string_view format() const noexcept
+    {
+        return format_;
+    }
+
+    /** @return Program operations */
+    const std::vector< op >& ops() const noexcept
+    {
+        return ops_;
+    }
+
+    /** Serialize encoded args into ostream, Policy is the encoding of args */
+    template< class Policy = fixed_encoding >
+    void run(std::ostream& os, const char* buffer, std::size_t size) const
+    {
+        details::run_format_ops< Policy >(os, format_.data(), ops_.data(), ops_.size(), buffer, size);
+    }
+
+    /** Serialize encoded args into buffer, Policy is the encoding of args */
+    template< class Policy = fixed_encoding >
+    void run(logfw::buffer& buf, const char* buffer, std::size_t size) const
+    {
+        details::run_format_ops< Policy >(buf, format_.data(), ops_.data(), ops_.size(), buffer, size);
+    }
+};
+
+/**
+ * Cache of compiled format programs.
+ *
+ * Programs are keyed either by format id or by address of format string,
+ * in the latter case the string must not change while it's cached.
+ */
+class program_cache
+{
+private:
+    std::unordered_map< std::uint32_t, format_program > by_id_;
+    std::unordered_map< const char*, format_program > by_address_;
+
+public:
+    /**
+     * Get program by format id, compile format on miss.
+     * @throw std::runtime_error on format error
+     */
+    const format_program& get(std::uint32_t id, std::string_view fmt)
+    {
+        auto found = by_id_.find(id);
+        if (LOGFW_LIKELY(found != by_id_.end())) {
+            return found->second;
+        }
+        return by_id_.emplace(id, format_program{fmt}).first->second;
+    }
+
+    /**
+     * Get program by format string address, compile format on miss.
+     * @throw std::runtime_error on format error
+     */
+    const format_program& get(std::string_view fmt)
+    {
+        auto found = by_address_.find(fmt.data());
+        if (LOGFW_LIKELY(found != by_address_.end())) {
+            return found->second;
+        }
+        return by_address_.emplace(fmt.data(), format_program{fmt}).first->second;
+    }
+
+    /** Drop all programs */
+    void clear() noexcept
+    {
+        by_id_.clear();
+        by_address_.clear();
+    }
+};
+
+} /* namespace logfw */
+
+#endif /* KSERGEY_format_program_051018102214 */
@@ -0,0 +1,324 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_format_registry_041018093145
+#define KSERGEY_format_registry_041018093145
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#include "compiler.hpp"
+#include "level.hpp"
+#include "make_format.hpp"
+
+namespace logfw {
+
+/** Registered format with call-site metadata */
+struct format_info
+{
+    /* Format string (make_format<...>::str()) */
+    std::string_view format;
+    /* Source file, empty if unknown */
+    std::string_view file;
+    /* Function name, empty if unknown */
+    std::string_view function;
+    /* Source line, zero if unknown */
+    std::uint32_t line{0};
+    /* Compile-time parsed format (make_format<...>::segments()), nullptr if unknown */
+    const details::format_op* ops{nullptr};
+    /* Number of format operations */
+    std::uint32_t ops_count{0};
+    /* Call-site severity */
+    logfw::level level{level::info};
+    /* Call-site category, empty if unknown */
+    std::string_view category;
+    /* Call-site enable flag, nullptr if the site could not be disabled */
+    std::atomic< bool >* enabled{nullptr};
+};
+
+/**
+ * Global table of formats.
+ *
+ * Each format gets a small stable id on registration. Entries are never
+ * removed, lookup by id is lock-free.
+ */
+class format_registry
+{
+private:
+    static constexpr std::size_t chunk_bits = 10;
+    static constexpr std::size_t chunk_size = std::size_t(1) << chunk_bits;
+    static constexpr std::size_t max_chunks = 1024;
+
+    std::mutex mutex_;
+    std::unique_ptr< format_info[] > chunks_[max_chunks];
+    std::atomic< std::uint32_t > size_{0};
+
+    /* Level applied to sites registered later, guarded by mutex */
+    logfw::level level_{level::trace};
+
+    format_registry()
+    {
+        /* Literals are rendered in-process from the registry */
+        details::default_literal_source() = {
+            [](void* context, std::uint32_t id, std::string_view& value) {
+                const format_info* info = static_cast< format_registry* >(context)->find(id);
+                if (info) {
+                    value = info->format;
+                }
+                return info != nullptr;
+            },
+            this
+        };
+    }
+
+public:
+    format_registry(const format_registry&) = delete;
+    format_registry& operator=(const format_registry&) = delete;
+
+    /** @return Global registry */
+    static format_registry& instance()
+    {
+        static format_registry registry;
+        return registry;
+    }
+
+    /**
+     * Register format.
+     * @return Format id
+     */
+    std::uint32_t add(const format_info& info)
+    {
+        std::lock_guard< std::mutex > lock{mutex_};
+
+        const std::uint32_t id = size_.load(std::memory_order_relaxed);
+        const std::size_t chunk = id >> chunk_bits;
+        if (LOGFW_UNLIKELY(chunk >= max_chunks)) {
+            throw std::length_error("Too many formats");
+        }
+        if (!chunks_[chunk]) {
+            chunks_[chunk].reset(new format_info[chunk_size]);
+        }
+        chunks_[chunk][id & (chunk_size - 1)] = info;
+        if (info.enabled) {
+            info.enabled->store(info.level >= level_, std::memory_order_relaxed);
+        }
+
+        size_.store(id + 1, std::memory_order_release);
+        return id;
+    }
+
+    /** @return Number of registered formats */
+    std::uint32_t size() const noexcept
+    {
+        return size_.load(std::memory_order_acquire);
+    }
+
+    /** @return Format by id or nullptr if id is unknown */
+    LOGFW_FORCE_INLINE const format_info* find(std::uint32_t id) const noexcept
+    {
+        if (LOGFW_UNLIKELY(id >= size())) {
+            return nullptr;
+        }
+        return &chunks_[id >> chunk_bits][id & (chunk_size - 1)];
+    }
+
+    /** Call f(id, info) for each registered format */
+    template< class F >
+    void for_each(F&& f) const
+    {
+        const std::uint32_t count = size();
+        for (std::uint32_t id = 0; id < count; ++id) {
+            f(id, *find(id));
+        }
+    }
+
+    /**
+     * Enable sites with level not less than value, disable others.
+     * Also applied to sites registered later.
+     */
+    void set_level(logfw::level value)
+    {
+        std::lock_guard< std::mutex > lock{mutex_};
+        level_ = value;
+        for_each_site([value](const format_info& info) {
+            return info.level >= value;
+        });
+    }
+
+    /**
+     * Enable or disable sites of category.
+     * @return Number of matched sites
+     */
+    std::size_t enable(std::string_view category, bool value)
+    {
+        return enable_if([category](const format_info& info) {
+            return info.category == category;
+        }, value);
+    }
+
+    /**
+     * Enable or disable site of format id.
+     * @return false if there is no site with the id
+     */
+    bool enable(std::uint32_t id, bool value)
+    {
+        const format_info* info = find(id);
+        if (!info || !info->enabled) {
+            return false;
+        }
+        info->enabled->store(value, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * Enable or disable sites matching predicate(info).
+     * @return Number of matched sites
+     */
+    template< class Predicate >
+    std::size_t enable_if(Predicate&& predicate, bool value)
+    {
+        std::lock_guard< std::mutex > lock{mutex_};
+        std::size_t count = 0;
+        for_each_site([&](const format_info& info) -> std::optional< bool > {
+            if (!predicate(info)) {
+                return std::nullopt;
+            }
+            ++count;
+            return value;
+        });
+        return count;
+    }
+
+private:
+    /* Store f(info) to each site enable flag, nullopt keeps the flag */
+    template< class F >
+    void for_each_site(F&& f)
+    {
+        for_each([&f](std::uint32_t, const format_info& info) {
+            if (info.enabled) {
+                const std::optional< bool > value = f(info);
+                if (value) {
+                    info.enabled->store(*value, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+};
+
+namespace details {
+
+/* Call-site enable flag, constant initialized */
+template< class StringHolder >
+struct site_flag
+{
+    static inline std::atomic< bool > enabled{true};
+};
+
+template< class T, class = void >
+struct has_level
+    : std::false_type
+{};
+template< class T >
+struct has_level< T, std::void_t< decltype(T::level()), decltype(T::category()) > >
+    : std::true_type
+{};
+
+template< class T, class = void >
+struct has_location
+    : std::false_type
+{};
+template< class T >
+struct has_location< T, std::void_t< decltype(T::file()), decltype(T::line()), decltype(T::function()) > >
+    : std::true_type
+{};
+
+/* Collect format_info from string holder */
+template< class StringHolder, class Format >
+inline format_info make_format_info()
+{
+    format_info info;
+    info.format = Format::str();
+    info.ops = Format::segments().data();
+    info.ops_count = static_cast< std::uint32_t >(Format::segments().size());
+    if constexpr (has_location< StringHolder >::value) {
+        info.file = StringHolder::file();
+        info.function = StringHolder::function();
+        info.line = StringHolder::line();
+    }
+    if constexpr (has_level< StringHolder >::value) {
+        info.level = StringHolder::level();
+        info.category = StringHolder::category();
+        info.enabled = &site_flag< StringHolder >::enabled;
+    }
+    return info;
+}
+
+} // namespace details
+
+/**
+ * Id of format constructed from string holder and args.
+ *
+ * Formats are registered during static initialization. String holder
+ * may provide call-site metadata via static file(), line() and function()
+ * (see LOGFW_DEFINE_SITE), and severity via static level() and category()
+ * (see LOGFW_DEFINE_LOG_SITE).
+ */
+template< class StringHolder, class... Args >
+struct format_id
+{
+    using format = make_format< StringHolder, Args... >;
+
+    static inline const std::uint32_t value = format_registry::instance().add(
+            details::make_format_info< StringHolder, format >());
+};
+
+/**
+ * @return true if call site is enabled (see format_registry::set_level()
+ *      and format_registry::enable())
+ */
+template< class Site >
+LOGFW_FORCE_INLINE bool site_enabled() noexcept
+{
+    return details::site_flag< Site >::enabled.load(std::memory_order_relaxed);
+}
+
+} /* namespace logfw */
+
+/**
+ * Define string holder struct with format string and call-site metadata.
+ * Should be used inside function body.
+ */
+#define LOGFW_DEFINE_SITE(name, fmt)                                                                \
+    static constexpr const char* name##_function = __func__;                                        \
+    struct name                                                                                     \
+    {                                                                                               \
+        static constexpr const char* data() { return fmt; }                                         \
+        static constexpr const char* file() { return __FILE__; }                                    \
+        static constexpr std::uint32_t line() { return __LINE__; }                                  \
+        static constexpr const char* function() { return name##_function; }                         \
+    }
+
+/**
+ * Define string holder struct with format string, call-site metadata and
+ * severity. Site could be disabled at runtime, see site_enabled().
+ */
+#define LOGFW_DEFINE_LOG_SITE(name, lvl, cat, fmt)                                                  \
+    static constexpr const char* name##_function = __func__;                                        \
+    struct name                                                                                     \
+    {                                                                                               \
+        static constexpr const char* data() { return fmt; }                                         \
+        static constexpr const char* file() { return __FILE__; }                                    \
+        static constexpr std::uint32_t line() { return __LINE__; }                                  \
+        static constexpr const char* function() { return name##_function; }                         \
+        static constexpr ::logfw::level level() { return lvl; }                                     \
+        static constexpr const char* category() { return cat; }                                     \
+    }
+
+#endif /* KSERGEY_format_registry_041018093145 */
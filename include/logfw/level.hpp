@@ -0,0 +1,53 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_level_111018153402
+#define KSERGEY_level_111018153402
+
+#include <cstdint>
+#include <string_view>
+
+/* Level values for LOGFW_MIN_LEVEL */
+#define LOGFW_LEVEL_TRACE 0
+#define LOGFW_LEVEL_DEBUG 1
+#define LOGFW_LEVEL_INFO 2
+#define LOGFW_LEVEL_WARNING 3
+#define LOGFW_LEVEL_ERROR 4
+#define LOGFW_LEVEL_CRITICAL 5
+
+/* Statements below the level are compiled out */
+#ifndef LOGFW_MIN_LEVEL
+#   define LOGFW_MIN_LEVEL LOGFW_LEVEL_TRACE
+#endif
+
+namespace logfw {
+
+/** Record severity */
+enum class level : std::uint8_t
+{
+    trace = LOGFW_LEVEL_TRACE,
+    debug = LOGFW_LEVEL_DEBUG,
+    info = LOGFW_LEVEL_INFO,
+    warning = LOGFW_LEVEL_WARNING,
+    error = LOGFW_LEVEL_ERROR,
+    critical = LOGFW_LEVEL_CRITICAL
+};
+
+/** @return Level name */
+constexpr std::string_view to_string(level value) noexcept
+{
+    switch (value) {
+        case level::trace: return "trace";
+        case level::debug: return "debug";
+        case level::info: return "info";
+        case level::warning: return "warning";
+        case level::error: return "error";
+        case level::critical: return "critical";
+    }
+    return "unknown";
+}
+
+} /* namespace logfw */
+
+#endif /* KSERGEY_level_111018153402 */
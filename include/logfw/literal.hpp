@@ -0,0 +1,95 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_literal_121018151204
+#define KSERGEY_literal_121018151204
+
+#include <cstdint>
+#include <string_view>
+
+#include "compiler.hpp"
+#include "format_registry.hpp"
+#include "details/literal_impl.hpp"
+
+namespace logfw {
+
+namespace details {
+
+/* Registry id of string literal, registered during static initialization */
+template< class StringHolder >
+struct literal_id
+{
+    static inline const std::uint32_t value = [] {
+        format_info info;
+        info.format = StringHolder::data();
+        return format_registry::instance().add(info);
+    }();
+};
+
+} // namespace details
+
+/** @return Literal of string holder (see LOGFW_LITERAL) */
+template< class StringHolder >
+LOGFW_FORCE_INLINE literal make_literal() noexcept
+{
+    return literal{details::literal_id< StringHolder >::value};
+}
+
+/**
+ * Render literals from dictionary of other process while in scope
+ * (calling thread only).
+ *
+ * Dictionary should provide find(id) returning const format_info*
+ * (binary::file_reader, shm_consumer).
+ */
+template< class Dictionary >
+class literal_scope
+{
+private:
+    details::literal_source previous_;
+
+public:
+    explicit literal_scope(Dictionary& dictionary)
+        : previous_(details::local_literal_source())
+    {
+        details::local_literal_source() = {
+            [](void* context, std::uint32_t id, std::string_view& value) {
+                const format_info* info = static_cast< Dictionary* >(context)->find(id);
+                if (info) {
+                    value = info->format;
+                }
+                return info != nullptr;
+            },
+            &dictionary
+        };
+    }
+
+    literal_scope(const literal_scope&) = delete;
+    literal_scope& operator=(const literal_scope&) = delete;
+
+    ~literal_scope()
+    {
+        details::local_literal_source() = previous_;
+    }
+};
+
+} /* namespace logfw */
+
+/**
+ * String literal argument encoded as 4 bytes id instead of string bytes.
+ * Text is stored once in the format registry (and the dictionary of
+ * binary logs and shared memory), e.g.
+ *
+ *     LOGFW_INFO(logger, "order", "side={}", LOGFW_LITERAL("BUY"));
+ */
+#define LOGFW_LITERAL(str)                                                                          \
+    ([] {                                                                                           \
+        struct logfw_literal                                                                        \
+        {                                                                                           \
+            static constexpr const char* data() { return str; }                                     \
+        };                                                                                          \
+        return ::logfw::make_literal< logfw_literal >();                                            \
+    }())
+
+#endif /* KSERGEY_literal_121018151204 */
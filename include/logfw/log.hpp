@@ -0,0 +1,72 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_log_111018161420
+#define KSERGEY_log_111018161420
+
+#include "compiler.hpp"
+#include "format_registry.hpp"
+#include "level.hpp"
+
+/*
+ * Logging statements.
+ *
+ * logger is an object with enqueue< Site >(args...) (backend, shm_producer).
+ * Statements below LOGFW_MIN_LEVEL are compiled out together with their
+ * arguments. Other statements cost a single branch on the site enable
+ * flag while disabled.
+ */
+
+/**
+ * Log statement with explicit level (level name, e.g. info).
+ * Enabled branch is out of line, disabled statement falls through.
+ */
+#define LOGFW_LOG(logger, lvl, category, fmt, ...)                                                  \
+    do {                                                                                            \
+        LOGFW_DEFINE_LOG_SITE(logfw_site, ::logfw::level::lvl, category, fmt);                      \
+        if (LOGFW_UNLIKELY(::logfw::site_enabled< logfw_site >())) {                                \
+            (logger).template enqueue< logfw_site >(__VA_ARGS__);                                   \
+        }                                                                                           \
+    } while (false)
+
+#define LOGFW_DISABLED_LOG(logger, category, fmt, ...)                                              \
+    do {} while (false)
+
+#if LOGFW_MIN_LEVEL <= LOGFW_LEVEL_TRACE
+#   define LOGFW_TRACE(logger, category, fmt, ...) LOGFW_LOG(logger, trace, category, fmt, ##__VA_ARGS__)
+#else
+#   define LOGFW_TRACE(logger, category, fmt, ...) LOGFW_DISABLED_LOG(logger, category, fmt)
+#endif
+
+#if LOGFW_MIN_LEVEL <= LOGFW_LEVEL_DEBUG
+#   define LOGFW_DEBUG(logger, category, fmt, ...) LOGFW_LOG(logger, debug, category, fmt, ##__VA_ARGS__)
+#else
+#   define LOGFW_DEBUG(logger, category, fmt, ...) LOGFW_DISABLED_LOG(logger, category, fmt)
+#endif
+
+#if LOGFW_MIN_LEVEL <= LOGFW_LEVEL_INFO
+#   define LOGFW_INFO(logger, category, fmt, ...) LOGFW_LOG(logger, info, category, fmt, ##__VA_ARGS__)
+#else
+#   define LOGFW_INFO(logger, category, fmt, ...) LOGFW_DISABLED_LOG(logger, category, fmt)
+#endif
+
+#if LOGFW_MIN_LEVEL <= LOGFW_LEVEL_WARNING
+#   define LOGFW_WARNING(logger, category, fmt, ...) LOGFW_LOG(logger, warning, category, fmt, ##__VA_ARGS__)
+#else
+#   define LOGFW_WARNING(logger, category, fmt, ...) LOGFW_DISABLED_LOG(logger, category, fmt)
+#endif
+
+#if LOGFW_MIN_LEVEL <= LOGFW_LEVEL_ERROR
+#   define LOGFW_ERROR(logger, category, fmt, ...) LOGFW_LOG(logger, error, category, fmt, ##__VA_ARGS__)
+#else
+#   define LOGFW_ERROR(logger, category, fmt, ...) LOGFW_DISABLED_LOG(logger, category, fmt)
+#endif
+
+#if LOGFW_MIN_LEVEL <= LOGFW_LEVEL_CRITICAL
+#   define LOGFW_CRITICAL(logger, category, fmt, ...) LOGFW_LOG(logger, critical, category, fmt, ##__VA_ARGS__)
+#else
+#   define LOGFW_CRITICAL(logger, category, fmt, ...) LOGFW_DISABLED_LOG(logger, category, fmt)
+#endif
+
+#endif /* KSERGEY_log_111018161420 */
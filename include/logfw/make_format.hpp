@@ -5,118 +5,185 @@
 #ifndef MADLIFE_make_format_291116173253_MADLIFE
 #define MADLIFE_make_format_291116173253_MADLIFE
 
+#include <array>
+
+#include "details/format_parser.hpp"
 #include "details/meta.hpp"
 #include "details/type_format.hpp"
 
 namespace logfw {
 namespace details {
 
-/* Represent a type in char-sequence */
-template< class T, typename FormatSpec >
-struct format_type
+/* Format string errors, reported by make_format static assertions */
+enum class format_error
 {
-    using raw_type = clear_type< T >;
-    /* true if no formating flags was in {} */
-    static constexpr const bool empty_spec = std::is_same< FormatSpec, null_type >::value;
-
-    /* fmt0="{type" */
-    using fmt0 = append< char_list< '{' >, typename type_format< raw_type >::type >;
-    /* fmt1="{type:" or fmt1="{type" */
-    using fmt1 = std::conditional_t< empty_spec, fmt0, append< fmt0, ch< ':' > > >;
-    /* fmt2="{type:spec" or fmt2="{type" */
-    using fmt2 = append< fmt1, FormatSpec >;
-
-    /* type="{type:spec}" or type="{type}" */
-    using type = append< fmt2, ch< '}' > >;
+    none,
+    close_brace_not_found,
+    unexpected_close_brace,
+    open_brace_in_spec,
+    not_enough_args,
+    too_many_args
 };
 
-/* static_assert helper */
-template< class T >
-struct always_false
-    : std::false_type
-{};
-
-/* Find '}' in charlist sequence */
-template< class InputList, class OutputList, std::size_t N >
-struct find_close_brace;
-template< class InputList, class OutputList >
-struct find_close_brace< list< ch< '}' >, InputList >, OutputList, 1 >
-{
-    using before = OutputList;
-    using after = InputList;
-};
-template< char C, class InputList, class OutputList, std::size_t N >
-struct find_close_brace< list< ch< C >, InputList >, OutputList, N >
-    : find_close_brace< InputList, append< OutputList, ch< C > >, N >
-{
-    static_assert( C != '{', "" );
-};
-template< class OutputList, std::size_t N >
-struct find_close_brace< null_type, OutputList, N >
+/**
+ * Insert argument types into format string, i.e. "{} {x}" -> "{i32} {u64:x}".
+ *
+ * Calls out(str) for each output piece. Single pass over format string,
+ * cost of compilation is linear in format length.
+ */
+template< class Output >
+constexpr format_error compile_format(std::string_view fmt, const std::string_view* types, std::size_t count,
+        Output& out) noexcept
 {
-    /* Make diagnostic easier */
-    static_assert( always_false< OutputList >::value, "close brace not found" );
-};
+    std::size_t arg = 0;
+    /* Start of current literal text */
+    std::size_t literal = 0;
 
-/* Format string */
-template< class StringList, class TypeList >
-struct format_impl;
-template<>
-struct format_impl< null_type, null_type >
-{
-    using type = null_type;
-};
-template< class TypeList >
-struct format_impl< null_type, TypeList >
-{
-    using type = null_type;
-    static_assert( details::always_false< TypeList >::value,
-            "There are more vars than format tokens" );
-};
-template< class StringList, class TypeList >
-struct format_impl< list< ch< '{' >, list< ch< '{' >, StringList > >, TypeList >
-{
-    /* Replace {{ -> { */
-    using type = list< ch< '{' >, list < ch< '{' >, typename format_impl< StringList, TypeList >::type > >;
-};
-template< class StringList, class TypeList >
-struct format_impl< list< ch< '}' >, list< ch< '}' >, StringList > >, TypeList >
-{
-    /* Replace }} -> } */
-    using type = list< ch< '}' >, list < ch< '}' >, typename format_impl< StringList, TypeList >::type > >;
-};
-template< class StringList, class TypeList >
-struct format_impl< list< ch< '}' >, StringList >, TypeList >
-{
-    /* Found close brace without open brace */
-    static_assert( always_false< TypeList >::value,
-            "Not expected close brace" );
-    using type = null_type;
-};
-template< class StringList, class TypeList >
-struct format_impl< list< ch< '{' >, StringList >, TypeList >
+    for (std::size_t index = 0; index < fmt.size(); ++index) {
+        const char ch = fmt[index];
+
+        if (ch == '{') {
+
+            if (next_is< '{' >(fmt, index)) {
+                /* Keep "{{" as is */
+                ++index;
+                continue;
+            }
+
+            const std::size_t found = find_char(fmt, '}', index + 1);
+            if (found == std::string_view::npos) {
+                return format_error::close_brace_not_found;
+            }
+
+            /* Format specifier without type, i.e. <flags><width>.<precision> */
+            const std::string_view spec = fmt.substr(index + 1, found - index - 1);
+            if (find_char(spec, '{') != std::string_view::npos) {
+                return format_error::open_brace_in_spec;
+            }
+            if (arg == count) {
+                return format_error::not_enough_args;
+            }
+
+            out(fmt.substr(literal, index + 1 - literal));
+            out(types[arg++]);
+            if (!spec.empty()) {
+                out(":");
+                out(spec);
+            }
+
+            index = found;
+            literal = found;
+
+        } else if (ch == '}') {
+
+            if (!next_is< '}' >(fmt, index)) {
+                return format_error::unexpected_close_brace;
+            }
+            /* Keep "}}" as is */
+            ++index;
+
+        }
+    }
+
+    out(fmt.substr(literal));
+
+    return arg == count ? format_error::none : format_error::too_many_args;
+}
+
+/* Format string with argument types, built at compile time */
+template< class StringHolder, class... Args >
+struct format_string
 {
-    /* Found type specifier */
-    using close_brace = find_close_brace< StringList, null_type, 1 >;
-    /* Format specifier without type, i.e. <flags><width>.<precision> */
-    using format_spec = typename close_brace::before;
-    /* After close brace string */
-    using rest = typename close_brace::after;
-
-    static_assert( !std::is_same_v< TypeList, null_type >, "Not enought argument for formatting string" );
-
-    /* Get current argument type */
-    using T = head_type< TypeList >;
-    /* Construct format specifier */
-    using format_string = typename format_type< T, format_spec >::type;
-    using format_rest = typename format_impl< rest, tail_type< TypeList > >::type;
-    using type = append< format_string, format_rest >;
+    static constexpr std::string_view fmt = StringHolder::data();
+
+    /* Argument type names in order of Args */
+    static constexpr std::array< std::string_view, sizeof...(Args) > types = {{
+        type_format< clear_type< Args > >::name...
+    }};
+
+    /* Each argument adds type name and ':' at most */
+    static constexpr std::size_t capacity = fmt.size() + (0 + ... + type_format< clear_type< Args > >::name.size())
+        + sizeof...(Args);
+
+    struct result
+    {
+        format_error error{format_error::none};
+        static_string< capacity > value;
+
+        constexpr void operator()(std::string_view str) noexcept
+        {
+            value.append(str);
+        }
+    };
+
+    static constexpr result make() noexcept
+    {
+        result r;
+        r.error = compile_format(fmt, types.data(), types.size(), r);
+        return r;
+    }
+
+    /* Format is compiled once per instantiation */
+    static constexpr result compiled = make();
+    static constexpr format_error error = compiled.error;
+    static constexpr const static_string< capacity >& value = compiled.value;
 };
-template< class C, class StringList, class TypeList >
-struct format_impl< list< C, StringList >, TypeList >
+
+/* Compile-time table of format operations */
+template< class Format, class... Args >
+struct format_segments
 {
-    /* iterate to next symbol */
-    using type = list< C, typename format_impl< StringList, TypeList >::type >;
+    static constexpr std::string_view fmt = Format::str();
+    static constexpr std::size_t count = count_format_ops(fmt);
+
+    /* Argument types in order of Args */
+    static constexpr std::array< type_tag, sizeof...(Args) > tags = {{
+        type_format< clear_type< Args > >::tag...
+    }};
+
+    /* User types in order of Args */
+    static constexpr std::array< const user_type_info*, sizeof...(Args) > users = {{
+        user_type_of< clear_type< Args > >()...
+    }};
+
+    /* Array element types in order of Args */
+    static constexpr std::array< type_tag, sizeof...(Args) > elements = {{
+        element_tag_of< clear_type< Args > >()...
+    }};
+
+    /* Parser handler */
+    struct builder
+    {
+        std::array< format_op, count > ops{};
+        std::size_t size{0};
+        std::size_t args{0};
+
+        constexpr void literal(std::size_t offset, std::size_t length)
+        {
+            ops[size].offset = static_cast< std::uint32_t >(offset);
+            ops[size].size = static_cast< std::uint32_t >(length);
+            ++size;
+        }
+
+        constexpr void arg(std::string_view, std::string_view flags)
+        {
+            ops[size].tag = tags[args];
+            ops[size].user = users[args];
+            ops[size].element = elements[args];
+            ++args;
+            ops[size].spec = parse_format_spec(flags);
+            ++size;
+        }
+    };
+
+    static constexpr std::array< format_op, count > make()
+    {
+        builder b;
+        parse_format(fmt, b);
+        return b.ops;
+    }
+
+    static constexpr std::array< format_op, count > value = make();
 };
 
 } /* namespace details */
@@ -126,14 +193,52 @@ struct format_impl< list< C, StringList >, TypeList >
  *
  * make_format<...>::data() - const char* line
  * make_format<...>::size() - size of line
+ * make_format<...>::str() - line as std::string_view
+ * make_format<...>::segments() - compile-time table of format operations
  */
 template< class StringHolder, class... Args >
-using make_format = details::stringify<
-    typename details::format_impl<
-        details::string_list< StringHolder >,
-        details::make_list< Args...>
-    >::type
->;
+struct make_format
+{
+private:
+    using format = details::format_string< StringHolder, Args... >;
+
+    static_assert( format::error != details::format_error::close_brace_not_found,
+            "close brace not found" );
+    static_assert( format::error != details::format_error::unexpected_close_brace,
+            "Not expected close brace" );
+    static_assert( format::error != details::format_error::open_brace_in_spec,
+            "Open brace in format specifier" );
+    static_assert( format::error != details::format_error::not_enough_args,
+            "Not enough arguments for formatting string" );
+    static_assert( format::error != details::format_error::too_many_args,
+            "There are more vars than format tokens" );
+
+public:
+    /** @return Null-terminated format string */
+    static LOGFW_FORCE_INLINE constexpr const char* data() noexcept
+    {
+        return format::value.data();
+    }
+
+    static LOGFW_FORCE_INLINE constexpr std::size_t size() noexcept
+    {
+        return format::value.size();
+    }
+
+    static LOGFW_FORCE_INLINE constexpr std::string_view str() noexcept
+    {
+        return format::value.str();
+    }
+
+    /**
+     * Literal text spans and argument type tags with pre-parsed formatting
+     * flags, i.e. format parsed at compile time.
+     */
+    static constexpr const auto& segments() noexcept
+    {
+        return details::format_segments< make_format, Args... >::value;
+    }
+};
 
 } /* namespace logfw */
 
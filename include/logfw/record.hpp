@@ -0,0 +1,144 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_record_021018150304
+#define KSERGEY_record_021018150304
+
+#include <cstdint>
+#include <cstring>
+
+#include "clock.hpp"
+#include "compiler.hpp"
+#include "encoder.hpp"
+#include "format_registry.hpp"
+#include "spsc_ring.hpp"
+
+namespace logfw {
+
+/**
+ * Header of encoded record.
+ *
+ * layout of a record: [record_header][encoded-args]
+ */
+struct record_header
+{
+    /* Format id (see format_registry) */
+    std::uint32_t format;
+    /* Encoded args size */
+    std::uint32_t size;
+    /* record_clock ticks, see clock_calibration */
+    std::uint64_t timestamp;
+};
+
+/** @return Exact record size (header and encoded args) */
+template< class... Args >
+LOGFW_FORCE_INLINE std::size_t record_bytes_required(const Args&... args)
+{
+    return sizeof(record_header) + record_encoder::bytes_required(args...);
+}
+
+/**
+ * Encode record into the ring.
+ * Format is constructed from string holder and args types (see format_id).
+ *
+ * Exact size is reserved for records with strings or arrays, their worst
+ * case would waste the ring. Otherwise space for the worst case is reserved
+ * first and exact size is calculated only if it doesn't fit (e.g. compact
+ * encoded integers).
+ *
+ * Queue is spsc_ring or anything with the same reserve/commit interface
+ * (e.g. spill_queue).
+ *
+ * @return Record size (header and encoded args) or zero if there is no space in the ring
+ */
+template< class StringHolder, class Queue, class... Args >
+LOGFW_FORCE_INLINE std::size_t enqueue_record(Queue& ring, const Args&... args)
+{
+    char* buffer;
+    if constexpr (record_encoder::variable_size< Args... >()) {
+        buffer = ring.reserve(record_bytes_required(args...));
+        if (LOGFW_UNLIKELY(!buffer)) {
+            return 0;
+        }
+    } else {
+        static constexpr std::size_t max_size = sizeof(record_header) + record_encoder::max_bytes_required< Args... >();
+
+        buffer = ring.reserve(max_size);
+        if (LOGFW_UNLIKELY(!buffer)) {
+            const std::size_t size = record_bytes_required(args...);
+            /* Folded for args of constant size */
+            if (size == max_size) {
+                return 0;
+            }
+            buffer = ring.reserve(size);
+            if (!buffer) {
+                return 0;
+            }
+        }
+    }
+
+    record_header header;
+    header.format = format_id< StringHolder, Args... >::value;
+    header.timestamp = record_clock::now();
+    header.size = static_cast< std::uint32_t >(record_encoder::encode< Args... >(buffer + sizeof(header), args...));
+    std::memcpy(buffer, &header, sizeof(header));
+
+    ring.commit(sizeof(header) + header.size);
+    return sizeof(header) + header.size;
+}
+
+/**
+ * Encode record into the ring, see enqueue_record().
+ * @return false if there is no space in the ring
+ */
+template< class StringHolder, class Queue, class... Args >
+LOGFW_FORCE_INLINE bool enqueue(Queue& ring, const Args&... args)
+{
+    return enqueue_record< StringHolder >(ring, args...) != 0;
+}
+
+namespace details {
+
+/* Site of the record which replaces a gap of dropped records */
+struct dropped_records_site
+{
+    static constexpr const char* data() { return "{} records dropped"; }
+    static constexpr ::logfw::level level() { return ::logfw::level::warning; }
+    static constexpr const char* category() { return "logfw"; }
+};
+
+} // namespace details
+
+/**
+ * Encode "N records dropped" record into the ring.
+ * @return false if there is no space in the ring
+ */
+template< class Queue >
+inline bool enqueue_dropped(Queue& ring, std::uint64_t count)
+{
+    return enqueue< details::dropped_records_site >(ring, count);
+}
+
+/**
+ * Access next record in the ring.
+ * @param[out] header is record header
+ * @return Pointer to encoded args or nullptr if the ring is empty
+ *
+ * Record should be released with spsc_ring::pop()
+ */
+LOGFW_FORCE_INLINE const char* front_record(spsc_ring& ring, record_header& header) noexcept
+{
+    std::size_t size;
+    const char* frame = ring.front(size);
+    if (!frame) {
+        return nullptr;
+    }
+
+    std::memcpy(&header, frame, sizeof(header));
+    return frame + sizeof(header);
+}
+
+} /* namespace logfw */
+
+#endif /* KSERGEY_record_021018150304 */
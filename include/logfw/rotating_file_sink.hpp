@@ -0,0 +1,422 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_rotating_file_sink_171018183207
+#define KSERGEY_rotating_file_sink_171018183207
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "binary_format.hpp"
+#include "compiler.hpp"
+#include "sink.hpp"
+#include "stats.hpp"
+
+namespace logfw {
+
+/** Rotating file sink settings */
+struct rotating_file_sink_options
+{
+    /* Segment file size in bytes, preallocated with fallocate() */
+    std::size_t segment_size = 256 * 1024 * 1024;
+    /* Max segment age, zero to rotate by size only */
+    std::chrono::seconds max_age{0};
+    /* Prefault pages of a segment on open */
+    bool populate = true;
+    /* Min interval between attempts to open a segment after a failure */
+    std::chrono::milliseconds retry_interval{1000};
+};
+
+/**
+ * Rotating binary log file sink.
+ *
+ * Records are copied into memory mapped segment files of fixed size,
+ * preallocated with fallocate(). Segment is switched when the next record
+ * doesn't fit or segment is older than max_age. Each segment is a complete
+ * binary log file (see logfw-decode).
+ *
+ * Next segment is opened and mapped ahead by a helper thread. Previous
+ * segment is unmapped and truncated to its used size by the same thread.
+ * Backend thread never waits for the helper thread, records are dropped
+ * if the next segment is not ready yet.
+ * Data is followed by end marker, so a segment left by a crashed process
+ * is still readable.
+ *
+ * Segment files are named "<prefix>.<sequence number>", e.g. "trades.000001".
+ *
+ * Records are dropped (see dropped()) while there is no segment after
+ * i/o error, next attempt to open a segment is made after retry_interval.
+ * Segment is opened by backend thread only if the helper thread failed
+ * or its segment is too small for the grown dictionary.
+ */
+class rotating_file_sink final
+    : public record_sink
+{
+private:
+    struct segment
+    {
+        std::string path;
+        std::uint64_t sequence{0};
+        int fd{-1};
+        char* data{nullptr};
+        std::size_t size{0};
+        /* Write position */
+        std::size_t pos{0};
+        /* Time the segment became current, age is counted from it */
+        std::chrono::steady_clock::time_point started;
+
+        /** @return Free space, end marker space is not included */
+        std::size_t space() const noexcept
+        {
+            return size - pos - sizeof(record_header);
+        }
+
+        /* Output interface of binary::stream_writer, space is checked by sink */
+
+        char* prepare(std::size_t count) noexcept
+        {
+            assert( count <= space() );
+            return data + pos;
+        }
+
+        void commit(std::size_t count) noexcept
+        {
+            pos += count;
+        }
+
+        void append(const char* str, std::size_t count) noexcept
+        {
+            assert( count <= space() );
+            std::memcpy(data + pos, str, count);
+            pos += count;
+        }
+
+        void append(std::string_view str) noexcept
+        {
+            append(str.data(), str.size());
+        }
+    };
+
+    std::string prefix_;
+    rotating_file_sink_options options_;
+
+    /* Backend thread state */
+    segment current_;
+    binary::stream_writer writer_;
+    /* Records written into the current segment */
+    std::size_t records_{0};
+    clock_params clock_{0, 0, 1.0};
+    bool calibrated_{false};
+    /* No attempts to open a segment until this time after a failure */
+    std::chrono::steady_clock::time_point retry_at_{};
+    stat_counter dropped_;
+
+    /* Helper thread state, guarded by mutex */
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_{false};
+    /* Next segment should be prepared */
+    bool prepare_{false};
+    /* Helper thread is opening next segment, backend thread doesn't wait for it */
+    bool preparing_{false};
+    segment next_;
+    std::vector< segment > retired_;
+    std::uint64_t sequence_{0};
+
+public:
+    /**
+     * Open first segment.
+     * @throw std::runtime_error on i/o error
+     */
+    explicit rotating_file_sink(std::string prefix, rotating_file_sink_options options = {})
+        : prefix_(std::move(prefix))
+        , options_(options)
+    {
+        const std::uint32_t count = format_registry::instance().size();
+        start(open_segment(sequence_++, count), count);
+        prepare_ = true;
+
+        thread_ = std::thread([this] {
+            run();
+        });
+    }
+
+    rotating_file_sink(const rotating_file_sink&) = delete;
+    rotating_file_sink& operator=(const rotating_file_sink&) = delete;
+
+    ~rotating_file_sink() override
+    {
+        {
+            std::lock_guard< std::mutex > lock{mutex_};
+            stop_ = true;
+            if (current_.data) {
+                retired_.push_back(std::exchange(current_, segment{}));
+            }
+        }
+        cv_.notify_all();
+        thread_.join();
+
+        /* Unused */
+        close_segment(next_);
+    }
+
+    /** @return Path of the current segment, empty if there is no open segment */
+    const std::string& path() const noexcept
+    {
+        return current_.path;
+    }
+
+    /** @return Number of records dropped because of i/o errors or size, could be called from any thread */
+    std::uint64_t dropped() const noexcept
+    {
+        return dropped_.load();
+    }
+
+    void write(const record_header& header, const char* payload) override
+    {
+        /* Formats could be registered by other threads, dictionary is written up to count */
+        const std::uint32_t count = format_registry::instance().size();
+        if (LOGFW_UNLIKELY(!reserve(writer_.bytes_required(header, count)))) {
+            dropped_.add(1);
+            return;
+        }
+        writer_.write(current_, header, payload, count);
+        mark_end();
+        ++records_;
+    }
+
+    void calibrate(const clock_params& params) override
+    {
+        clock_ = params;
+        calibrated_ = true;
+        if (reserve(binary::stream_writer::calibration_size)) {
+            writer_.calibrate(current_, params);
+            mark_end();
+        }
+    }
+
+    void flush() override
+    {
+        if (options_.max_age.count() > 0 && records_ > 0
+                && std::chrono::steady_clock::now() - current_.started >= options_.max_age) {
+            rotate();
+        }
+    }
+
+private:
+    /** @return false if size bytes could not be written */
+    LOGFW_FORCE_INLINE bool reserve(std::size_t size)
+    {
+        if (LOGFW_LIKELY(current_.data && size <= current_.space())) {
+            return true;
+        }
+        if (size > options_.segment_size / 2) {
+            /* Never fits */
+            return false;
+        }
+        if (!current_.data && std::chrono::steady_clock::now() < retry_at_) {
+            /* Open failed recently */
+            return false;
+        }
+        rotate();
+        return current_.data && size <= current_.space();
+    }
+
+    void rotate()
+    {
+        const std::uint32_t count = format_registry::instance().size();
+        segment next;
+        bool late;
+        bool usable = false;
+        std::uint64_t sequence = 0;
+        {
+            std::lock_guard< std::mutex > lock{mutex_};
+            if (current_.data) {
+                retired_.push_back(std::exchange(current_, segment{}));
+            }
+            records_ = 0;
+            /* Helper thread is late, records are dropped instead of waiting for the disk */
+            late = !next_.data && (prepare_ || preparing_);
+            if (!late) {
+                next = std::exchange(next_, segment{});
+                /* Helper thread failed or dictionary has grown */
+                usable = next.data && next.space() >= required_space(count);
+                if (!usable) {
+                    /* Taken before the helper thread takes next one to keep segments ordered */
+                    sequence = sequence_++;
+                }
+                prepare_ = true;
+            }
+        }
+        cv_.notify_all();
+
+        if (late) {
+            return;
+        }
+        if (!usable) {
+            close_segment(next);
+            try {
+                next = open_segment(sequence, count);
+            } catch (const std::exception&) {
+                /* Nowhere to report, records are dropped until the next attempt */
+                retry_at_ = std::chrono::steady_clock::now() + options_.retry_interval;
+                return;
+            }
+        }
+        start(std::move(next), count);
+    }
+
+    /* Start writing segment, dictionary is written for first count formats */
+    void start(segment&& s, std::uint32_t count)
+    {
+        current_ = std::move(s);
+        /* Segment might be opened ahead long ago */
+        current_.started = std::chrono::steady_clock::now();
+        records_ = 0;
+        writer_ = binary::stream_writer{};
+        writer_.begin(current_, 0, count);
+        if (calibrated_) {
+            writer_.calibrate(current_, clock_);
+        }
+        mark_end();
+    }
+
+    /* Readers stop at end marker instead of preallocated zeros */
+    LOGFW_FORCE_INLINE void mark_end() noexcept
+    {
+        record_header header;
+        header.format = binary::end_frame;
+        header.size = 0;
+        header.timestamp = 0;
+        std::memcpy(current_.data + current_.pos, &header, sizeof(header));
+    }
+
+    /* Space for file header, dictionary of first count formats and calibration */
+    static std::size_t required_space(std::uint32_t count) noexcept
+    {
+        return binary::stream_writer::begin_size(count) + binary::stream_writer::calibration_size;
+    }
+
+    /*
+     * Open segment large enough for dictionary of first count formats.
+     * @throw std::runtime_error on i/o error
+     */
+    segment open_segment(std::uint64_t sequence, std::uint32_t count) const
+    {
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), ".%06llu", static_cast< unsigned long long >(sequence));
+
+        segment s;
+        s.path = prefix_ + suffix;
+        s.sequence = sequence;
+        /* Dictionary should take no more than a half of segment */
+        s.size = std::max(options_.segment_size, 2 * required_space(count) + sizeof(record_header));
+
+        s.fd = ::open(s.path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (s.fd < 0) {
+            throw std::runtime_error("Failed to open \"" + s.path + "\": " + std::strerror(errno));
+        }
+
+        int rc = ::fallocate(s.fd, 0, 0, s.size);
+        if (rc != 0 && errno == EOPNOTSUPP) {
+            rc = ::ftruncate(s.fd, s.size);
+        }
+        if (rc != 0) {
+            const int error = errno;
+            close_segment(s);
+            throw std::runtime_error("Failed to allocate \"" + s.path + "\": " + std::strerror(error));
+        }
+
+        void* data = ::mmap(nullptr, s.size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | (options_.populate ? MAP_POPULATE : 0), s.fd, 0);
+        if (data == MAP_FAILED) {
+            const int error = errno;
+            close_segment(s);
+            throw std::runtime_error("Failed to map \"" + s.path + "\": " + std::strerror(error));
+        }
+        s.data = static_cast< char* >(data);
+        return s;
+    }
+
+    /* Unmap segment and truncate it to used size, empty segment is removed */
+    static void close_segment(segment& s) noexcept
+    {
+        if (s.fd < 0) {
+            return;
+        }
+        if (s.data) {
+            ::munmap(s.data, s.size);
+        }
+        if (s.pos > 0) {
+            ::ftruncate(s.fd, s.pos);
+        } else {
+            ::unlink(s.path.c_str());
+        }
+        ::close(s.fd);
+        s = segment{};
+    }
+
+    /* Helper thread */
+    void run()
+    {
+        std::unique_lock< std::mutex > lock{mutex_};
+        while (true) {
+            cv_.wait(lock, [this] {
+                return stop_ || prepare_ || !retired_.empty();
+            });
+
+            std::vector< segment > retired;
+            retired.swap(retired_);
+            const bool prepare = prepare_ && !stop_;
+            prepare_ = false;
+            preparing_ = prepare;
+            const std::uint64_t sequence = prepare ? sequence_++ : 0;
+            lock.unlock();
+
+            for (auto& s: retired) {
+                close_segment(s);
+            }
+
+            segment next;
+            if (prepare) {
+                try {
+                    next = open_segment(sequence, format_registry::instance().size());
+                } catch (const std::exception&) {
+                    /* Backend thread will try to open the segment itself */
+                }
+            }
+
+            lock.lock();
+            if (prepare) {
+                next_ = std::move(next);
+                preparing_ = false;
+                cv_.notify_all();
+            }
+            if (stop_ && retired_.empty()) {
+                break;
+            }
+        }
+    }
+};
+
+} /* namespace logfw */
+
+#endif /* KSERGEY_rotating_file_sink_171018183207 */
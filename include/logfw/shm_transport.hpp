@@ -0,0 +1,633 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_shm_transport_101018112519
+#define KSERGEY_shm_transport_101018112519
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "binary_format.hpp"
+#include "clock.hpp"
+#include "compiler.hpp"
+#include "format_registry.hpp"
+#include "record.hpp"
+#include "spsc_ring.hpp"
+
+/*
+ * Shared memory transport of encoded records.
+ *
+ * Producer process creates shared memory object with a header, format
+ * dictionary and a fixed number of queue slots. Each producer thread
+ * claims a slot with a spsc_ring. Consumer process attaches, discovers
+ * claimed slots, drains and formats records. Memory outlives a crashed
+ * producer, so the last records could still be consumed.
+ *
+ * layout: [shm_header][shm_slot]...[dictionary][ring]...
+ */
+
+namespace logfw {
+
+namespace details {
+
+/* Shared memory object magic */
+static constexpr const char shm_magic[8] = {'L', 'O', 'G', 'F', 'W', 'S', 'H', 'M'};
+
+/* Shared memory layout version */
+static constexpr std::uint16_t shm_version = 4;
+
+/* Queue slot states */
+enum shm_slot_state : std::uint32_t
+{
+    /* Slot could be claimed by producer thread */
+    slot_free = 0,
+    /* Slot is used by producer thread */
+    slot_used = 1,
+    /* Producer thread exited, slot is free after the ring is drained */
+    slot_released = 2
+};
+
+/* Shared memory object header */
+struct shm_header
+{
+    /* Written last, object is ready when magic is valid */
+    char magic[8];
+    std::uint16_t version;
+    /* sizeof(void*) of the producer */
+    std::uint8_t pointer_size;
+    /* sizeof(record_header) of the producer */
+    std::uint8_t record_header_size;
+    std::uint32_t byte_order;
+    std::int32_t producer_pid;
+    std::uint32_t max_queues;
+    /* Timestamp source of records (LOGFW_CLOCK) */
+    std::uint32_t clock;
+    /* Encoding of record args (LOGFW_ENCODING) */
+    std::uint32_t encoding;
+    std::uint64_t queue_capacity;
+    std::uint64_t dictionary_offset;
+    std::uint64_t dictionary_capacity;
+    std::uint64_t queues_offset;
+    /* Bytes of dictionary written */
+    alignas(LOGFW_CACHE_LINE_SIZE) std::atomic< std::uint64_t > dictionary_size;
+};
+
+/* Queue slot */
+struct shm_slot
+{
+    std::atomic< std::uint32_t > state;
+    /* Producer thread id */
+    std::uint32_t tid;
+};
+
+/* Mapped shared memory object */
+class shm_mapping
+{
+private:
+    std::string name_;
+    char* data_{nullptr};
+    std::size_t size_{0};
+
+public:
+    /**
+     * Create (size > 0) or open (size == 0) shared memory object.
+     * @throw std::runtime_error on error
+     */
+    shm_mapping(const std::string& name, std::size_t size)
+        : name_(name)
+    {
+        const bool create = size > 0;
+        if (create) {
+            ::shm_unlink(name.c_str());
+        }
+
+        const int fd = ::shm_open(name.c_str(), create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, 0600);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open shared memory \"" + name + "\": " + std::strerror(errno));
+        }
+
+        struct stat st;
+        if (create && ::ftruncate(fd, size) < 0) {
+            const int error = errno;
+            ::close(fd);
+            throw std::runtime_error("Failed to resize shared memory \"" + name + "\": " + std::strerror(error));
+        } else if (!create) {
+            if (::fstat(fd, &st) < 0) {
+                const int error = errno;
+                ::close(fd);
+                throw std::runtime_error("Failed to stat shared memory \"" + name + "\": " + std::strerror(error));
+            }
+            size = st.st_size;
+        }
+
+        void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        const int error = errno;
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Failed to map shared memory \"" + name + "\": " + std::strerror(error));
+        }
+
+        data_ = static_cast< char* >(data);
+        size_ = size;
+    }
+
+    shm_mapping(const shm_mapping&) = delete;
+    shm_mapping& operator=(const shm_mapping&) = delete;
+
+    ~shm_mapping()
+    {
+        ::munmap(data_, size_);
+    }
+
+    char* data() const noexcept
+    {
+        return data_;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    const std::string& name() const noexcept
+    {
+        return name_;
+    }
+
+    shm_header& header() const noexcept
+    {
+        return *reinterpret_cast< shm_header* >(data_);
+    }
+
+    shm_slot& slot(std::uint32_t index) const noexcept
+    {
+        return reinterpret_cast< shm_slot* >(data_ + sizeof(shm_header))[index];
+    }
+
+    /* Ring memory of slot */
+    void* ring(std::uint32_t index) const noexcept
+    {
+        const shm_header& h = header();
+        return data_ + h.queues_offset + index * spsc_ring::memory_size(h.queue_capacity);
+    }
+};
+
+} // namespace details
+
+/** Shared memory transport settings */
+struct shm_options
+{
+    /* Shared memory object name, e.g. "/logfw.myapp" */
+    std::string name;
+    /* Max number of producer threads */
+    std::uint32_t max_queues = 64;
+    /* Per-thread queue size in bytes, power of two */
+    std::size_t queue_capacity = 1024 * 1024;
+    /* Format dictionary size in bytes */
+    std::size_t dictionary_capacity = 1024 * 1024;
+};
+
+/**
+ * Producer side of shared memory transport.
+ *
+ * Shared memory object is left after destruction (so records survive
+ * a crash), consumer removes it. A thread logging into several producers
+ * claims a queue slot in each of them.
+ */
+class shm_producer
+{
+private:
+    /* Per-thread queue */
+    struct thread_queue
+    {
+        std::shared_ptr< details::shm_mapping > mapping;
+        details::shm_slot& slot;
+        spsc_ring ring;
+
+        thread_queue(std::shared_ptr< details::shm_mapping > m, std::uint32_t index)
+            : mapping(std::move(m))
+            , slot(mapping->slot(index))
+            , ring(mapping->ring(index), mapping->header().queue_capacity)
+        {}
+
+        ~thread_queue()
+        {
+            slot.state.store(details::slot_released, std::memory_order_release);
+        }
+    };
+
+    /* Thread local reference to the queue of a producer */
+    struct queue_ref
+    {
+        std::uint64_t owner;
+        /* Expires with the producer */
+        std::weak_ptr< const void > alive;
+        std::unique_ptr< thread_queue > queue;
+    };
+
+    std::uint64_t id_;
+    std::shared_ptr< details::shm_mapping > mapping_;
+    /* Referenced by producer only, see queue_ref */
+    std::shared_ptr< const void > alive_{std::make_shared< bool >(true)};
+
+    /* Guards dictionary and slot allocation */
+    std::mutex mutex_;
+    /* Number of formats in dictionary */
+    std::atomic< std::uint32_t > format_count_{0};
+
+    /* Number of attempts to wait for a released slot (100us each) */
+    static constexpr int claim_attempts = 10000;
+
+public:
+    /**
+     * Create shared memory object.
+     * @throw std::runtime_error on error
+     */
+    explicit shm_producer(const shm_options& options)
+        : id_(next_id())
+    {
+        const std::size_t capacity = options.queue_capacity;
+        if (capacity < 16 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("Queue capacity should be a power of two");
+        }
+
+        const std::size_t slots_size = sizeof(details::shm_header) + options.max_queues * sizeof(details::shm_slot);
+        const std::size_t dictionary_offset = align(slots_size);
+        const std::size_t queues_offset = align(dictionary_offset + options.dictionary_capacity);
+        const std::size_t size = queues_offset + options.max_queues * spsc_ring::memory_size(capacity);
+
+        mapping_ = std::make_shared< details::shm_mapping >(options.name, size);
+
+        details::shm_header& header = mapping_->header();
+        header.version = details::shm_version;
+        header.pointer_size = sizeof(void*);
+        header.record_header_size = sizeof(record_header);
+        header.byte_order = binary::byte_order_mark;
+        header.producer_pid = ::getpid();
+        header.max_queues = options.max_queues;
+        header.clock = record_clock_id;
+        header.encoding = record_encoding_id;
+        header.queue_capacity = capacity;
+        header.dictionary_offset = dictionary_offset;
+        header.dictionary_capacity = options.dictionary_capacity;
+        header.queues_offset = queues_offset;
+        header.dictionary_size.store(0, std::memory_order_relaxed);
+
+        publish_dictionary();
+
+        /* Mark object as ready */
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(header.magic, details::shm_magic, sizeof(header.magic));
+    }
+
+    shm_producer(const shm_producer&) = delete;
+    shm_producer& operator=(const shm_producer&) = delete;
+
+    /** @return Shared memory object name */
+    const std::string& name() const noexcept
+    {
+        return mapping_->name();
+    }
+
+    /**
+     * @return Queue of the calling thread, claimed on first call
+     * @throw std::runtime_error if there are no free queues (waits up to
+     *      one second for the consumer to drain queues of exited threads)
+     */
+    LOGFW_FORCE_INLINE spsc_ring& local_queue()
+    {
+        std::vector< queue_ref >& refs = local_refs();
+        if (LOGFW_LIKELY(!refs.empty() && refs.front().owner == id_)) {
+            return refs.front().queue->ring;
+        }
+        return local_queue_slow(refs);
+    }
+
+    /**
+     * Encode record into the calling thread queue.
+     * @return false if the queue is full
+     */
+    template< class StringHolder, class... Args >
+    LOGFW_FORCE_INLINE bool enqueue(const Args&... args)
+    {
+        /* Record might refer to later registered format or literal */
+        if (LOGFW_UNLIKELY(format_registry::instance().size() != format_count_.load(std::memory_order_relaxed))) {
+            publish_dictionary();
+        }
+        return logfw::enqueue< StringHolder >(local_queue(), args...);
+    }
+
+    /**
+     * Copy formats registered since last call into shared dictionary.
+     * @throw std::length_error if dictionary is full
+     */
+    void publish_dictionary()
+    {
+        std::lock_guard< std::mutex > lock{mutex_};
+
+        const format_registry& registry = format_registry::instance();
+        details::shm_header& header = mapping_->header();
+        char* dictionary = mapping_->data() + header.dictionary_offset;
+        std::uint64_t size = header.dictionary_size.load(std::memory_order_relaxed);
+
+        std::uint32_t id = format_count_.load(std::memory_order_relaxed);
+        for (; id < registry.size(); ++id) {
+            const format_info& info = *registry.find(id);
+
+            binary::dictionary_entry entry;
+            entry.id = id;
+            entry.line = info.line;
+            entry.format_size = static_cast< std::uint32_t >(info.format.size());
+            entry.file_size = static_cast< std::uint32_t >(info.file.size());
+            entry.function_size = static_cast< std::uint32_t >(info.function.size());
+
+            const std::size_t entry_size = sizeof(entry) + info.format.size() + info.file.size() + info.function.size();
+            if (size + entry_size > header.dictionary_capacity) {
+                throw std::length_error("Shared memory dictionary is full");
+            }
+
+            char* ptr = dictionary + size;
+            std::memcpy(ptr, &entry, sizeof(entry));
+            ptr += sizeof(entry);
+            /* Internal sites have no file and function (null data) */
+            for (std::string_view str: {info.format, info.file, info.function}) {
+                if (!str.empty()) {
+                    std::memcpy(ptr, str.data(), str.size());
+                    ptr += str.size();
+                }
+            }
+            size += entry_size;
+        }
+
+        header.dictionary_size.store(size, std::memory_order_release);
+        format_count_.store(id, std::memory_order_release);
+    }
+
+private:
+    static std::uint64_t next_id() noexcept
+    {
+        static std::atomic< std::uint64_t > counter{0};
+        return ++counter;
+    }
+
+    static std::size_t align(std::size_t value) noexcept
+    {
+        return (value + LOGFW_CACHE_LINE_SIZE - 1) & ~std::size_t(LOGFW_CACHE_LINE_SIZE - 1);
+    }
+
+    /* Queues of the calling thread, one per producer, the most recently used is first */
+    static std::vector< queue_ref >& local_refs() noexcept
+    {
+        static thread_local std::vector< queue_ref > refs;
+        return refs;
+    }
+
+    spsc_ring& local_queue_slow(std::vector< queue_ref >& refs)
+    {
+        /* Slots of destroyed producers are released */
+        refs.erase(std::remove_if(refs.begin(), refs.end(), [](const queue_ref& ref) {
+            return ref.alive.expired();
+        }), refs.end());
+
+        auto found = std::find_if(refs.begin(), refs.end(), [this](const queue_ref& ref) {
+            return ref.owner == id_;
+        });
+        if (found == refs.end()) {
+            refs.push_back({id_, alive_, claim_queue()});
+            found = refs.end() - 1;
+        }
+
+        std::rotate(refs.begin(), found, found + 1);
+        return refs.front().queue->ring;
+    }
+
+    /* @throw std::runtime_error if there are no free queues */
+    std::unique_ptr< thread_queue > claim_queue()
+    {
+        const std::uint32_t max_queues = mapping_->header().max_queues;
+
+        /* Released slots become free once the consumer drains them */
+        for (int attempt = 0; attempt < claim_attempts; ++attempt) {
+            {
+                std::lock_guard< std::mutex > lock{mutex_};
+
+                bool released = false;
+                for (std::uint32_t index = 0; index < max_queues; ++index) {
+                    details::shm_slot& slot = mapping_->slot(index);
+                    const std::uint32_t state = slot.state.load(std::memory_order_acquire);
+                    if (state != details::slot_free) {
+                        released |= state == details::slot_released;
+                        continue;
+                    }
+
+                    spsc_ring::init(mapping_->ring(index));
+                    slot.tid = static_cast< std::uint32_t >(::syscall(SYS_gettid));
+                    slot.state.store(details::slot_used, std::memory_order_release);
+
+                    return std::make_unique< thread_queue >(mapping_, index);
+                }
+
+                if (!released) {
+                    break;
+                }
+            }
+
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+
+        throw std::runtime_error("No free shared memory queues");
+    }
+};
+
+/**
+ * Consumer side of shared memory transport.
+ */
+class shm_consumer
+{
+private:
+    std::unique_ptr< details::shm_mapping > mapping_;
+    std::vector< std::unique_ptr< spsc_ring > > rings_;
+    std::vector< format_info > dictionary_;
+    std::uint64_t dictionary_pos_{0};
+
+public:
+    /**
+     * Attach to shared memory object.
+     * @throw std::runtime_error on error or if object is not ready yet
+     */
+    explicit shm_consumer(const std::string& name)
+        : mapping_(std::make_unique< details::shm_mapping >(name, 0))
+    {
+        if (mapping_->size() < sizeof(details::shm_header)) {
+            throw std::runtime_error("Shared memory object is not ready");
+        }
+
+        const details::shm_header& header = mapping_->header();
+        if (std::memcmp(header.magic, details::shm_magic, sizeof(header.magic)) != 0) {
+            throw std::runtime_error("Shared memory object is not ready");
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (header.version != details::shm_version) {
+            throw std::runtime_error("Unsupported shared memory layout version");
+        }
+        if (header.byte_order != binary::byte_order_mark || header.pointer_size != sizeof(void*)
+                || header.record_header_size != sizeof(record_header)) {
+            throw std::runtime_error("Unsupported ABI");
+        }
+        if (header.encoding != LOGFW_ENCODING_FIXED && header.encoding != LOGFW_ENCODING_COMPACT) {
+            throw std::runtime_error("Unsupported record encoding");
+        }
+        if (header.dictionary_offset + header.dictionary_capacity > mapping_->size()) {
+            throw std::runtime_error("Corrupted dictionary");
+        }
+
+        rings_.resize(header.max_queues);
+        update_dictionary();
+    }
+
+    /** Remove shared memory object, it stays mapped */
+    void unlink() noexcept
+    {
+        ::shm_unlink(mapping_->name().c_str());
+    }
+
+    /**
+     * @return true if record timestamps could be converted to wall-clock
+     *      time with local clock_calibration (same clock on the same host)
+     */
+    bool same_clock() const noexcept
+    {
+        return mapping_->header().clock == record_clock_id && record_clock_id != LOGFW_CLOCK_NONE;
+    }
+
+    /** @return Encoding of record args (LOGFW_ENCODING) */
+    std::uint32_t encoding() const noexcept
+    {
+        return mapping_->header().encoding;
+    }
+
+    /** @return true if producer process is running */
+    bool producer_alive() const noexcept
+    {
+        const pid_t pid = mapping_->header().producer_pid;
+        return ::kill(pid, 0) == 0 || errno == EPERM;
+    }
+
+    /** @return Format by id or nullptr if id is unknown */
+    const format_info* find(std::uint32_t id)
+    {
+        if (LOGFW_UNLIKELY(id >= dictionary_.size() || dictionary_[id].format.data() == nullptr)) {
+            update_dictionary();
+            if (id >= dictionary_.size() || dictionary_[id].format.data() == nullptr) {
+                return nullptr;
+            }
+        }
+        return &dictionary_[id];
+    }
+
+    /**
+     * Consume available records, calls f(header, payload) for each record.
+     * @return Number of consumed records
+     */
+    template< class F >
+    std::size_t poll(F&& f, std::size_t batch_size = 1024)
+    {
+        std::size_t count = 0;
+
+        for (std::uint32_t index = 0; index < rings_.size(); ++index) {
+            details::shm_slot& slot = mapping_->slot(index);
+            const std::uint32_t state = slot.state.load(std::memory_order_acquire);
+
+            if (state == details::slot_free) {
+                continue;
+            }
+
+            if (!rings_[index]) {
+                rings_[index] = std::make_unique< spsc_ring >(mapping_->ring(index), mapping_->header().queue_capacity);
+            }
+
+            spsc_ring& ring = *rings_[index];
+            std::size_t consumed = 0;
+            record_header header;
+            while (consumed < batch_size) {
+                const char* payload = front_record(ring, header);
+                if (!payload) {
+                    break;
+                }
+                f(header, payload);
+                ring.pop();
+                ++consumed;
+            }
+            count += consumed;
+
+            if (state == details::slot_released && ring.empty()) {
+                /* Producer thread exited, return slot */
+                rings_[index].reset();
+                slot.state.store(details::slot_free, std::memory_order_release);
+            }
+        }
+
+        return count;
+    }
+
+private:
+    /* @throw std::runtime_error if dictionary is corrupted */
+    void update_dictionary()
+    {
+        const details::shm_header& header = mapping_->header();
+        const char* dictionary = mapping_->data() + header.dictionary_offset;
+        /* Written by another process, nothing is trusted */
+        const std::uint64_t size = std::min< std::uint64_t >(header.dictionary_size.load(std::memory_order_acquire),
+                header.dictionary_capacity);
+
+        while (dictionary_pos_ + sizeof(binary::dictionary_entry) <= size) {
+            binary::dictionary_entry entry;
+            std::memcpy(&entry, dictionary + dictionary_pos_, sizeof(entry));
+
+            const std::uint64_t entry_size = sizeof(entry) + std::uint64_t(entry.format_size) + entry.file_size
+                + entry.function_size;
+            /* Ids are assigned in order, bound id before allocation */
+            if (dictionary_pos_ + entry_size > size || entry.id > dictionary_.size()) {
+                throw std::runtime_error("Corrupted dictionary");
+            }
+
+            const char* ptr = dictionary + dictionary_pos_ + sizeof(entry);
+            format_info info;
+            info.format = {ptr, entry.format_size};
+            info.file = {ptr + entry.format_size, entry.file_size};
+            info.function = {ptr + entry.format_size + entry.file_size, entry.function_size};
+            info.line = entry.line;
+
+            if (entry.id == dictionary_.size()) {
+                dictionary_.emplace_back();
+            }
+            dictionary_[entry.id] = info;
+
+            dictionary_pos_ += entry_size;
+        }
+    }
+};
+
+} /* namespace logfw */
+
+#endif /* KSERGEY_shm_transport_101018112519 */
@@ -0,0 +1,84 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_sink_031018112047
+#define KSERGEY_sink_031018112047
+
+#include <ostream>
+#include <string_view>
+
+#include "clock.hpp"
+#include "record.hpp"
+
+namespace logfw {
+
+/** Destination of rendered records */
+class sink
+{
+public:
+    virtual ~sink() = default;
+
+    /**
+     * Write rendered record.
+     * Record text includes trailing new line.
+     */
+    virtual void write(std::string_view record) = 0;
+
+    /**
+     * Flush buffered records.
+     * Called after each batch of records and periodically while there are
+     * no records (see backend_options::idle_flush_interval)
+     */
+    virtual void flush()
+    {}
+};
+
+/** Destination of encoded records */
+class record_sink
+{
+public:
+    virtual ~record_sink() = default;
+
+    /** Write encoded record */
+    virtual void write(const record_header& header, const char* payload) = 0;
+
+    /** Clock calibration for timestamps of the following records */
+    virtual void calibrate([[maybe_unused]] const clock_params& params)
+    {}
+
+    /**
+     * Flush buffered records.
+     * Called after each batch of records and periodically while there are
+     * no records (see backend_options::idle_flush_interval)
+     */
+    virtual void flush()
+    {}
+};
+
+/** Sink over std::ostream */
+class ostream_sink final
+    : public sink
+{
+private:
+    std::ostream& os_;
+
+public:
+    explicit ostream_sink(std::ostream& os)
+        : os_(os)
+    {}
+
+    void write(std::string_view record) override
+    {
+        os_.write(record.data(), record.size());
+    }
+
+    void flush() override
+    {
+        os_.flush();
+    }
+};
+
+} /* namespace logfw */
+
+#endif /* KSERGEY_sink_031018112047 */
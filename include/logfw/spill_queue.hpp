@@ -0,0 +1,153 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_spill_queue_171018143015
+#define KSERGEY_spill_queue_171018143015
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+
+#include "compiler.hpp"
+
+namespace logfw {
+
+/**
+ * Unbounded single-threaded queue of variable size frames in heap-allocated
+ * chunks.
+ *
+ * Has reserve/commit and front/pop interface of spsc_ring, holds records
+ * which don't fit into a full ring (see overflow_policy::spill). reserve()
+ * never fails but could allocate a chunk. One drained chunk is kept for reuse.
+ *
+ * layout of a frame: [frame-size (4 bytes)][frame-bytes][padding up to 8 bytes]
+ */
+class spill_queue
+{
+private:
+    /* Frame header size */
+    static constexpr std::size_t header_size = sizeof(std::uint32_t);
+    /* Frames are aligned to this value */
+    static constexpr std::size_t frame_alignment = 8;
+
+    struct chunk
+    {
+        std::unique_ptr< char[] > data;
+        std::size_t capacity{0};
+        /* Write position */
+        std::size_t size{0};
+        /* Read position */
+        std::size_t offset{0};
+    };
+
+    std::size_t chunk_size_;
+    std::deque< chunk > chunks_;
+    chunk spare_;
+    /* Frame header of the last reserved frame */
+    char* reserved_{nullptr};
+
+public:
+    /**
+     * Construct queue.
+     * @param[in] chunk_size is default chunk size in bytes, larger frames get own chunk
+     */
+    explicit spill_queue(std::size_t chunk_size = 64 * 1024) noexcept
+        : chunk_size_(chunk_size)
+    {}
+
+    spill_queue(const spill_queue&) = delete;
+    spill_queue& operator=(const spill_queue&) = delete;
+
+    /** @return true if there are no frames */
+    bool empty() const noexcept
+    {
+        return chunks_.empty();
+    }
+
+    /**
+     * Reserve space for a frame.
+     * @return Pointer to space for at least size bytes
+     * @throw std::bad_alloc
+     */
+    char* reserve(std::size_t size)
+    {
+        const std::size_t frame = frame_size(size);
+        if (chunks_.empty() || chunks_.back().capacity - chunks_.back().size < frame) {
+            chunks_.push_back(allocate(frame));
+        }
+        chunk& last = chunks_.back();
+        reserved_ = last.data.get() + last.size;
+        return reserved_ + header_size;
+    }
+
+    /**
+     * Publish previously reserved frame.
+     * @param[in] size is number of bytes actually used, not greater than reserved
+     */
+    void commit(std::size_t size) noexcept
+    {
+        const std::uint32_t value = static_cast< std::uint32_t >(size);
+        std::memcpy(reserved_, &value, header_size);
+        chunks_.back().size += frame_size(size);
+    }
+
+    /**
+     * Access next frame.
+     * @param[out] size is frame size
+     * @return Pointer to frame bytes or nullptr if the queue is empty
+     */
+    const char* front(std::size_t& size) const noexcept
+    {
+        if (chunks_.empty()) {
+            return nullptr;
+        }
+        const chunk& first = chunks_.front();
+        std::uint32_t value;
+        std::memcpy(&value, first.data.get() + first.offset, header_size);
+        size = value;
+        return first.data.get() + first.offset + header_size;
+    }
+
+    /** Release frame returned by front() */
+    void pop() noexcept
+    {
+        chunk& first = chunks_.front();
+        std::uint32_t value;
+        std::memcpy(&value, first.data.get() + first.offset, header_size);
+        first.offset += frame_size(value);
+
+        if (first.offset == first.size) {
+            if (first.capacity == chunk_size_ && !spare_.data) {
+                spare_ = std::move(first);
+            }
+            chunks_.pop_front();
+        }
+    }
+
+private:
+    chunk allocate(std::size_t frame)
+    {
+        chunk result;
+        if (spare_.data && frame <= spare_.capacity) {
+            result = std::move(spare_);
+        } else {
+            result.capacity = std::max(chunk_size_, frame);
+            result.data.reset(new char[result.capacity]);
+        }
+        result.size = 0;
+        result.offset = 0;
+        return result;
+    }
+
+    static constexpr std::size_t frame_size(std::size_t size) noexcept
+    {
+        return (header_size + size + frame_alignment - 1) & ~(frame_alignment - 1);
+    }
+};
+
+} /* namespace logfw */
+
+#endif /* KSERGEY_spill_queue_171018143015 */
@@ -0,0 +1,264 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_spsc_ring_021018141522
+#define KSERGEY_spsc_ring_021018141522
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+#include "compiler.hpp"
+
+namespace logfw {
+
+namespace details {
+
+/* Ring positions shared between producer and consumer */
+struct ring_control
+{
+    alignas(LOGFW_CACHE_LINE_SIZE) std::atomic< std::uint64_t > write_pos;
+    alignas(LOGFW_CACHE_LINE_SIZE) std::atomic< std::uint64_t > read_pos;
+};
+
+static_assert( std::atomic< std::uint64_t >::is_always_lock_free,
+        "Lock-free atomics required for shared memory rings" );
+
+} // namespace details
+
+/**
+ * Lock-free single-producer/single-consumer ring of variable size frames.
+ *
+ * Producer reserves contiguous space for a frame, fills it and commits
+ * the number of bytes actually used. Frames never wrap around the end
+ * of the buffer, unused tail is skipped with a padding frame.
+ *
+ * Ring positions and frames could be placed into external memory (e.g.
+ * shared between processes), see memory_size().
+ *
+ * layout of a frame: [frame-size (4 bytes)][frame-bytes][padding up to 8 bytes]
+ */
+class alignas(LOGFW_CACHE_LINE_SIZE) spsc_ring
+{
+private:
+    /* Frame header size */
+    static constexpr std::size_t header_size = sizeof(std::uint32_t);
+    /* Frames are aligned to this value */
+    static constexpr std::size_t frame_alignment = 8;
+    /* Frame size value which marks the skipped tail of the buffer */
+    static constexpr std::uint32_t padding_frame = std::numeric_limits< std::uint32_t >::max();
+
+    /* Shared read-only state */
+    std::unique_ptr< char[] > storage_;
+    details::ring_control* control_{nullptr};
+    char* data_{nullptr};
+    std::size_t capacity_{0};
+
+    /* Producer owned state */
+    alignas(LOGFW_CACHE_LINE_SIZE) std::uint64_t reserved_pos_{0};
+    std::uint64_t cached_read_pos_{0};
+
+    /* Consumer owned state */
+    alignas(LOGFW_CACHE_LINE_SIZE) std::uint64_t cached_write_pos_{0};
+
+public:
+    /**
+     * Construct ring.
+     * @param[in] capacity is buffer size in bytes, rounded up to the power of two
+     */
+    explicit spsc_ring(std::size_t capacity)
+    {
+        capacity = round_capacity(capacity);
+
+        /* Align memory on cache line to avoid sharing it with anything else */
+        storage_.reset(new char[memory_size(capacity) + LOGFW_CACHE_LINE_SIZE]);
+        const auto address = reinterpret_cast< std::uintptr_t >(storage_.get());
+        char* memory = storage_.get() + (LOGFW_CACHE_LINE_SIZE - address % LOGFW_CACHE_LINE_SIZE);
+
+        init(memory);
+        attach(memory, capacity);
+    }
+
+    /**
+     * Construct ring over external memory.
+     * @param[in] memory is cache line aligned block of memory_size(capacity) bytes,
+     *      initialized with init()
+     * @param[in] capacity is buffer size in bytes, power of two
+     */
+    spsc_ring(void* memory, std::size_t capacity)
+    {
+        if (capacity != round_capacity(capacity)) {
+            throw std::invalid_argument("Ring capacity should be a power of two");
+        }
+        attach(memory, capacity);
+    }
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator=(const spsc_ring&) = delete;
+
+    /** @return Size of memory block for ring with capacity */
+    static constexpr std::size_t memory_size(std::size_t capacity) noexcept
+    {
+        return sizeof(details::ring_control) + capacity;
+    }
+
+    /** Initialize memory block as an empty ring */
+    static void init(void* memory) noexcept
+    {
+        auto control = new (memory) details::ring_control;
+        control->write_pos.store(0, std::memory_order_relaxed);
+        control->read_pos.store(0, std::memory_order_relaxed);
+    }
+
+    /** @return Ring buffer size in bytes */
+    std::size_t capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+    /** @return Maximum frame size which could be ever reserved */
+    std::size_t max_frame_size() const noexcept
+    {
+        return capacity_ / 2 - header_size;
+    }
+
+    /**
+     * Reserve contiguous space for a frame (producer side).
+     * @return Pointer to space for at least size bytes or nullptr if the ring is full
+     */
+    LOGFW_FORCE_INLINE char* reserve(std::size_t size) noexcept
+    {
+        const std::size_t frame = frame_size(size);
+        const std::uint64_t pos = control_->write_pos.load(std::memory_order_relaxed);
+        const std::size_t offset = pos & (capacity_ - 1);
+        const std::size_t tail = capacity_ - offset;
+
+        /* The frame doesn't fit into the tail and the tail have to be skipped */
+        const std::size_t required = LOGFW_LIKELY(frame <= tail) ? frame : tail + frame;
+
+        if (LOGFW_UNLIKELY(pos + required - cached_read_pos_ > capacity_)) {
+            cached_read_pos_ = control_->read_pos.load(std::memory_order_acquire);
+            if (pos + required - cached_read_pos_ > capacity_) {
+                return nullptr;
+            }
+        }
+
+        if (LOGFW_LIKELY(frame <= tail)) {
+            reserved_pos_ = pos;
+        } else {
+            std::memcpy(data_ + offset, &padding_frame, header_size);
+            reserved_pos_ = pos + tail;
+        }
+
+        return data_ + (reserved_pos_ & (capacity_ - 1)) + header_size;
+    }
+
+    /**
+     * Publish previously reserved frame (producer side).
+     * @param[in] size is number of bytes actually used, not greater than reserved
+     */
+    LOGFW_FORCE_INLINE void commit(std::size_t size) noexcept
+    {
+        const std::uint32_t value = static_cast< std::uint32_t >(size);
+        std::memcpy(data_ + (reserved_pos_ & (capacity_ - 1)), &value, header_size);
+        control_->write_pos.store(reserved_pos_ + frame_size(size), std::memory_order_release);
+    }
+
+    /**
+     * Access next frame (consumer side).
+     * @param[out] size is frame size
+     * @return Pointer to frame bytes or nullptr if the ring is empty
+     */
+    LOGFW_FORCE_INLINE const char* front(std::size_t& size) noexcept
+    {
+        std::uint64_t pos = control_->read_pos.load(std::memory_order_relaxed);
+
+        while (true) {
+            if (pos == cached_write_pos_) {
+                cached_write_pos_ = control_->write_pos.load(std::memory_order_acquire);
+                if (pos == cached_write_pos_) {
+                    return nullptr;
+                }
+            }
+
+            const std::size_t offset = pos & (capacity_ - 1);
+            std::uint32_t value;
+            std::memcpy(&value, data_ + offset, header_size);
+
+            if (LOGFW_UNLIKELY(value == padding_frame)) {
+                /* Skip the tail of the buffer */
+                pos += capacity_ - offset;
+                control_->read_pos.store(pos, std::memory_order_release);
+                continue;
+            }
+
+            size = value;
+            return data_ + offset + header_size;
+        }
+    }
+
+    /** Release frame returned by front() (consumer side) */
+    LOGFW_FORCE_INLINE void pop() noexcept
+    {
+        const std::uint64_t pos = control_->read_pos.load(std::memory_order_relaxed);
+        std::uint32_t value;
+        std::memcpy(&value, data_ + (pos & (capacity_ - 1)), header_size);
+
+        assert( value != padding_frame );
+
+        control_->read_pos.store(pos + frame_size(value), std::memory_order_release);
+    }
+
+    /** @return true if there are no frames to consume (consumer side) */
+    bool empty() const noexcept
+    {
+        return control_->read_pos.load(std::memory_order_relaxed) == control_->write_pos.load(std::memory_order_acquire);
+    }
+
+    /** @return Number of bytes used by frames (consumer side) */
+    std::size_t size() const noexcept
+    {
+        return control_->write_pos.load(std::memory_order_acquire) - control_->read_pos.load(std::memory_order_relaxed);
+    }
+
+private:
+    static std::size_t round_capacity(std::size_t capacity)
+    {
+        if (capacity < frame_alignment * 2) {
+            throw std::invalid_argument("Ring capacity too small");
+        }
+
+        std::size_t result = frame_alignment * 2;
+        while (result < capacity) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    void attach(void* memory, std::size_t capacity) noexcept
+    {
+        control_ = static_cast< details::ring_control* >(memory);
+        data_ = static_cast< char* >(memory) + sizeof(details::ring_control);
+        capacity_ = capacity;
+
+        /* Ring might be non-empty */
+        const std::uint64_t pos = control_->read_pos.load(std::memory_order_acquire);
+        cached_read_pos_ = pos;
+        cached_write_pos_ = pos;
+    }
+
+    static constexpr std::size_t frame_size(std::size_t size) noexcept
+    {
+        return (header_size + size + frame_alignment - 1) & ~(frame_alignment - 1);
+    }
+};
+
+} /* namespace logfw */
+
+#endif /* KSERGEY_spsc_ring_021018141522 */
@@ -0,0 +1,172 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_stats_171018160248
+#define KSERGEY_stats_171018160248
+
+#include <atomic>
+#include <cstdint>
+
+#include "compiler.hpp"
+#include "level.hpp"
+
+namespace logfw {
+
+/**
+ * Counter with a single writer, could be read from any thread.
+ * Update is a plain load and store, no locked instructions.
+ */
+class stat_counter
+{
+private:
+    std::atomic< std::uint64_t > value_{0};
+
+public:
+    /** Increase value (writer side) */
+    LOGFW_FORCE_INLINE void add(std::uint64_t value) noexcept
+    {
+        value_.store(value_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    /** Set value (writer side) */
+    LOGFW_FORCE_INLINE void set(std::uint64_t value) noexcept
+    {
+        value_.store(value, std::memory_order_relaxed);
+    }
+
+    /** Set value if it is greater than current one (writer side) */
+    LOGFW_FORCE_INLINE void set_max(std::uint64_t value) noexcept
+    {
+        if (value > value_.load(std::memory_order_relaxed)) {
+            value_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    /** @return Current value */
+    LOGFW_FORCE_INLINE std::uint64_t load() const noexcept
+    {
+        return value_.load(std::memory_order_relaxed);
+    }
+};
+
+/** Counters of a producer queue */
+struct producer_stats
+{
+    /* Enqueued records */
+    std::uint64_t records{0};
+    /* Enqueued record bytes (headers and encoded args) */
+    std::uint64_t bytes{0};
+    /* Dropped records (see overflow_policy) */
+    std::uint64_t dropped{0};
+    /* Records put into spill queue (see overflow_policy) */
+    std::uint64_t spilled{0};
+    /* Max queue usage in bytes seen by backend */
+    std::uint64_t high_water{0};
+};
+
+/**
+ * Counters of a backend, producer counters are summed over all threads.
+ * Times are measured only with backend_options::timing set, zero otherwise.
+ */
+struct backend_stats
+    : producer_stats
+{
+    /* Age of the oldest unconsumed record at the last poll */
+    std::uint64_t lag_ns{0};
+    /* Max age of the oldest unconsumed record */
+    std::uint64_t max_lag_ns{0};
+    /* Rendered records */
+    std::uint64_t formatted{0};
+    /* Total and max rendering time */
+    std::uint64_t format_ns{0};
+    std::uint64_t max_format_ns{0};
+    /* Sink write calls */
+    std::uint64_t sink_writes{0};
+    /* Total and max sink write time */
+    std::uint64_t sink_ns{0};
+    std::uint64_t max_sink_ns{0};
+};
+
+namespace details {
+
+/* Producer queue counters */
+struct queue_counters
+{
+    /* Producer owned */
+    alignas(LOGFW_CACHE_LINE_SIZE) stat_counter records;
+    stat_counter bytes;
+    stat_counter dropped;
+    stat_counter spilled;
+
+    /* Backend owned */
+    alignas(LOGFW_CACHE_LINE_SIZE) stat_counter high_water;
+
+    producer_stats load() const noexcept
+    {
+        producer_stats result;
+        result.records = records.load();
+        result.bytes = bytes.load();
+        result.dropped = dropped.load();
+        result.spilled = spilled.load();
+        result.high_water = high_water.load();
+        return result;
+    }
+};
+
+/* Backend counters, all backend owned */
+struct backend_counters
+{
+    /* Sum of queue counters, updated on poll */
+    stat_counter records;
+    stat_counter bytes;
+    stat_counter dropped;
+    stat_counter spilled;
+    stat_counter high_water;
+
+    stat_counter lag_ns;
+    stat_counter max_lag_ns;
+    stat_counter formatted;
+    stat_counter format_ns;
+    stat_counter max_format_ns;
+    stat_counter sink_writes;
+    stat_counter sink_ns;
+    stat_counter max_sink_ns;
+
+    backend_stats load() const noexcept
+    {
+        backend_stats result;
+        result.records = records.load();
+        result.bytes = bytes.load();
+        result.dropped = dropped.load();
+        result.spilled = spilled.load();
+        result.high_water = high_water.load();
+        result.lag_ns = lag_ns.load();
+        result.max_lag_ns = max_lag_ns.load();
+        result.formatted = formatted.load();
+        result.format_ns = format_ns.load();
+        result.max_format_ns = max_format_ns.load();
+        result.sink_writes = sink_writes.load();
+        result.sink_ns = sink_ns.load();
+        result.max_sink_ns = max_sink_ns.load();
+        return result;
+    }
+};
+
+/* Site of periodic stats record */
+struct stats_site
+{
+    static constexpr const char* data()
+    {
+        return "stats: records {} ({} bytes), dropped {}, spilled {}, queue high-water {} bytes, "
+            "lag {} ns (max {}), format {} ns/record (max {}), sink write {} ns (max {})";
+    }
+    static constexpr ::logfw::level level() { return ::logfw::level::info; }
+    static constexpr const char* category() { return "logfw"; }
+};
+
+} // namespace details
+
+} /* namespace logfw */
+
+#endif /* KSERGEY_stats_171018160248 */
@@ -0,0 +1,75 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_user_type_121018181047
+#define KSERGEY_user_type_121018181047
+
+#include <string_view>
+#include <type_traits>
+
+#include "buffer.hpp"
+#include "compiler.hpp"
+#include "details/buffer_write_impl.hpp"
+#include "details/user_type_impl.hpp"
+#include "details/write_impl.hpp"
+
+/*
+ * User types as format arguments.
+ *
+ * Specialize logfw::user_type for the type:
+ *
+ *     template<>
+ *     struct logfw::user_type< Order >
+ *     {
+ *         // Type name in format strings, unique, without ':' and '}'
+ *         static constexpr const char* name() { return "Order"; }
+ *
+ *         // Backend-side formatter of encoded value
+ *         static void format(logfw::buffer& buf, const logfw::format_spec& spec, const Order& value)
+ *         {
+ *             buf.append("Order{id=");
+ *             logfw::format_to(buf, value.id);
+ *             buf.push_back('}');
+ *         }
+ *     };
+ *
+ * Value is copied into the record as is, so the type has to be trivially
+ * copyable. Otherwise (or to encode a part of the value) provide:
+ *
+ *         using encoded_type = OrderFields; // trivially copyable
+ *         static OrderFields encode(const Order& value);
+ *
+ * and format() taking const OrderFields&.
+ *
+ * Format string of other process is rendered with user types registered in
+ * the rendering process: types used for logging are registered
+ * automatically, others (e.g. in a decoder tool) with register_user_type().
+ */
+
+namespace logfw {
+
+/** Argument formatting flags */
+using format_spec = details::format_spec;
+
+/** Register user type for formats parsed at runtime */
+template< class T >
+inline void register_user_type()
+{
+    details::user_type_registry::instance().add(&details::user_type_entry< T >::value);
+}
+
+/** Render arithmetic value, string or pointer as an argument (for user formatters) */
+template< class T >
+LOGFW_FORCE_INLINE void format_to(buffer& buf, const T& value, const format_spec& spec = {})
+{
+    if constexpr (std::is_convertible_v< const T&, std::string_view >) {
+        details::format_value(buf, spec, std::string_view(value));
+    } else {
+        details::format_value(buf, spec, value);
+    }
+}
+
+} /* namespace logfw */
+
+#endif /* KSERGEY_user_type_121018181047 */
@@ -9,15 +9,19 @@
 
 #include "compiler.hpp"
 #include "decoder.hpp"
+#include "buffer.hpp"
+#include "details/buffer_write_impl.hpp"
+#include "details/format_parser.hpp"
 #include "details/write_impl.hpp"
 
 namespace logfw {
 
-/// Serialize format string into ostream
+/// Serialize format string into ostream, Policy is the encoding of args
+template< class Policy = fixed_encoding >
 LOGFW_FORCE_INLINE void write(std::ostream& os, std::string_view fmt, const char* buffer, size_t size)
 {
     /* argument decoder */
-    decoder dec{buffer, size};
+    basic_decoder< Policy > dec{buffer, size};
 
     for (std::size_t index = 0; index < fmt.size(); ++index) {
         char ch = fmt[index];
@@ -56,6 +60,17 @@ LOGFW_FORCE_INLINE void write(std::ostream& os, std::string_view fmt, const char
     }
 }
 
+/// Serialize format string into buffer, Policy is the encoding of args
+template< class Policy = fixed_encoding >
+LOGFW_FORCE_INLINE void write(buffer& buf, std::string_view fmt, const char* buffer, size_t size)
+{
+    /* argument decoder */
+    basic_decoder< Policy > dec{buffer, size};
+
+    details::buffer_format_writer< basic_decoder< Policy > > writer{buf, fmt, dec};
+    details::parse_format(fmt, writer);
+}
+
 } /* namespace logfw */
 
 #endif /* KSERGEY_write_290618133356 */
@@ -0,0 +1,145 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logfw/backend.hpp"
+#include "logfw/log.hpp"
+#include "test_common.hpp"
+
+/*
+ * Backend: thread queues of several backends, stats counters.
+ */
+
+using namespace logfw;
+
+namespace {
+
+backend_options make_options()
+{
+    backend_options options;
+    options.overflow = overflow_policy::block;
+    options.timestamps = false;
+    options.queue_capacity = 64 * 1024;
+    return options;
+}
+
+std::size_t thread_queues(backend& b)
+{
+    std::size_t count = 0;
+    b.for_each_thread_stats([&count](const producer_stats&) {
+        ++count;
+    });
+    return count;
+}
+
+void test_several_backends()
+{
+    const int count = 10000;
+    std::vector< std::string > first_lines;
+    std::vector< std::string > second_lines;
+
+    backend first{make_options()};
+    first.add_sink< test::capture_sink >(first_lines);
+    first.start();
+    backend second{make_options()};
+    second.add_sink< test::capture_sink >(second_lines);
+    second.start();
+
+    std::thread([&] {
+        for (int i = 0; i < count; ++i) {
+            LOGFW_INFO(first, "test", "first {}", i);
+            LOGFW_INFO(second, "test", "second {}", i);
+        }
+        /* Single queue per backend */
+        CHECK(thread_queues(first) == 1);
+        CHECK(thread_queues(second) == 1);
+        CHECK(first.local_stats().records == std::uint64_t(count));
+        CHECK(second.local_stats().records == std::uint64_t(count));
+    }).join();
+
+    first.stop();
+    second.stop();
+
+    CHECK(first_lines.size() == std::size_t(count));
+    CHECK(second_lines.size() == std::size_t(count));
+    for (int i = 0; i < count; ++i) {
+        CHECK(first_lines[i] == "first " + std::to_string(i));
+        CHECK(second_lines[i] == "second " + std::to_string(i));
+    }
+}
+
+void test_destroyed_backend()
+{
+    std::vector< std::string > lines;
+    for (int round = 0; round < 3; ++round) {
+        lines.clear();
+        backend b{make_options()};
+        b.add_sink< test::capture_sink >(lines);
+        b.start();
+        /* Queue of the previous backend is released by this thread */
+        LOGFW_INFO(b, "test", "round {}", round);
+        CHECK(thread_queues(b) == 1);
+        b.stop();
+        CHECK(lines.size() == 1);
+        CHECK(lines[0] == "round " + std::to_string(round));
+    }
+}
+
+void check_stats(bool timing)
+{
+    const int count = 1000;
+    std::vector< std::string > lines;
+
+    backend_options options = make_options();
+    options.timing = timing;
+    backend b{options};
+    b.add_sink< test::capture_sink >(lines);
+    b.start();
+    std::thread([&b] {
+        for (int i = 0; i < count; ++i) {
+            LOGFW_INFO(b, "test", "value {}", i);
+        }
+        const producer_stats local = b.local_stats();
+        CHECK(local.records == std::uint64_t(count));
+        CHECK(local.bytes >= count * (sizeof(record_header) + sizeof(int)));
+        CHECK(local.dropped == 0);
+    }).join();
+    b.stop();
+
+    const backend_stats stats = b.stats();
+    CHECK(stats.records == std::uint64_t(count));
+    CHECK(stats.dropped == 0);
+    CHECK(stats.spilled == 0);
+    CHECK(stats.high_water > 0);
+    CHECK(stats.formatted == std::uint64_t(count));
+    CHECK(stats.sink_writes == std::uint64_t(count));
+    if (timing) {
+        CHECK(stats.format_ns > 0);
+        CHECK(stats.max_format_ns > 0);
+    } else {
+        /* Clock is not read per record */
+        CHECK(stats.format_ns == 0);
+        CHECK(stats.sink_ns == 0);
+        CHECK(stats.max_sink_ns == 0);
+    }
+}
+
+void test_stats()
+{
+    check_stats(false);
+    check_stats(true);
+}
+
+} // namespace
+
+int main()
+{
+    test_several_backends();
+    test_destroyed_backend();
+    test_stats();
+    return 0;
+}
@@ -0,0 +1,83 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "logfw/backend.hpp"
+#include "logfw/binary_reader.hpp"
+#include "logfw/binary_sink.hpp"
+#include "logfw/log.hpp"
+#include "test_common.hpp"
+
+/*
+ * Binary log reader: corrupted files are rejected.
+ */
+
+using namespace logfw;
+
+namespace {
+
+void write_log(const std::string& path)
+{
+    backend b;
+    b.add_sink< binary_file_sink >(path);
+    b.start();
+    LOGFW_INFO(b, "test", "value {}", 1);
+    b.stop();
+}
+
+/* Overwrite id of the first dictionary entry */
+void set_first_entry_id(const std::string& path, std::uint32_t id)
+{
+    const int fd = ::open(path.c_str(), O_WRONLY);
+    CHECK(fd >= 0);
+    const off_t offset = sizeof(binary::file_header) + offsetof(binary::dictionary_entry, id);
+    CHECK(::pwrite(fd, &id, sizeof(id), offset) == sizeof(id));
+    ::close(fd);
+}
+
+std::string read_error(const std::string& path)
+{
+    try {
+        std::vector< std::string > lines;
+        test::read_binary_log(path, lines);
+    } catch (const std::runtime_error& e) {
+        return e.what();
+    }
+    return {};
+}
+
+void test_dictionary_id(const std::string& dir)
+{
+    const std::string path = dir + "/dictionary.bin";
+    write_log(path);
+
+    std::vector< std::string > lines;
+    CHECK(test::read_binary_log(path, lines));
+    CHECK(lines.size() == 1);
+    CHECK(lines[0] == "value 1");
+
+    /* Would allocate gigabytes or overflow */
+    for (std::uint32_t id: {1u, 0xfffffff0u, 0xffffffffu}) {
+        set_first_entry_id(path, id);
+        CHECK(read_error(path) == "Corrupted dictionary");
+    }
+}
+
+} // namespace
+
+int main()
+{
+    const std::string dir = test::make_temp_dir();
+    test_dictionary_id(dir);
+    test::remove_temp_dir(dir);
+    return 0;
+}
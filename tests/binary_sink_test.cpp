@@ -0,0 +1,108 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "logfw/backend.hpp"
+#include "logfw/binary_sink.hpp"
+#include "logfw/log.hpp"
+#include "test_common.hpp"
+
+/*
+ * Binary log files: plain and compressed files decode into the same
+ * records, partial compressed block is written after max_delay.
+ */
+
+using namespace logfw;
+
+namespace {
+
+void test_compressed_round_trip(const std::string& dir)
+{
+    const std::string plain_path = dir + "/plain.bin";
+    const std::string compressed_path = dir + "/compressed.bin";
+    const int count = 50000;
+
+    {
+        backend_options options;
+        options.overflow = overflow_policy::block;
+        backend b{options};
+        b.add_sink< binary_file_sink >(plain_path);
+        binary_file_sink_options compressed;
+        compressed.compress = true;
+        /* Frames span several blocks */
+        compressed.block_size = 4096;
+        b.add_sink< binary_file_sink >(compressed_path, compressed);
+        b.start();
+
+        const std::string_view symbols[] = {"AAPL", "MSFT", "GOOG", "AMZN"};
+        for (int i = 0; i < count; ++i) {
+            LOGFW_INFO(b, "test", "order {} {} px={.2} qty={}", i, symbols[i % 4], 100.0 + (i % 50) * 0.01, i % 7);
+        }
+        b.stop();
+    }
+
+    std::vector< std::string > plain;
+    CHECK(test::read_binary_log(plain_path, plain));
+    std::vector< std::string > compressed;
+    CHECK(test::read_binary_log(compressed_path, compressed));
+
+    CHECK(plain.size() == std::size_t(count));
+    CHECK(plain.front() == "order 0 AAPL px=100.00 qty=0");
+    CHECK(compressed == plain);
+    CHECK(test::file_size(compressed_path) < test::file_size(plain_path) * 3 / 4);
+
+    binary::file_reader reader{compressed_path};
+    CHECK(reader.compressed());
+}
+
+void test_compressed_max_delay(const std::string& dir)
+{
+    const std::string path = dir + "/idle.bin";
+
+    backend_options options;
+    options.idle_flush_interval = std::chrono::milliseconds(10);
+    backend b{options};
+    binary_file_sink_options sink_options;
+    sink_options.compress = true;
+    sink_options.max_delay = std::chrono::milliseconds(50);
+    b.add_sink< binary_file_sink >(path, sink_options);
+    b.start();
+
+    /* Only file header is written, dictionary is in the first block */
+    const std::size_t header_size = test::file_size(path);
+    CHECK(header_size == sizeof(binary::file_header));
+
+    for (int i = 0; i < 10; ++i) {
+        LOGFW_INFO(b, "test", "idle {}", i);
+    }
+
+    /* No more records, partial block is written by idle flush */
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (test::file_size(path) == header_size && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::vector< std::string > lines;
+    CHECK(test::read_binary_log(path, lines));
+    CHECK(lines.size() == 10);
+    CHECK(lines.back() == "idle 9");
+
+    b.stop();
+}
+
+} // namespace
+
+int main()
+{
+    const std::string dir = test::make_temp_dir();
+    test_compressed_round_trip(dir);
+    test_compressed_max_delay(dir);
+    test::remove_temp_dir(dir);
+    return 0;
+}
@@ -0,0 +1,113 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "logfw/decoder.hpp"
+#include "logfw/encoder.hpp"
+#include "test_common.hpp"
+
+/*
+ * Packs of arithmetic and pointer args: fixed_layout_impl writes the same
+ * bytes as per-arg encode_impl and the result is decoded by decoder.
+ */
+
+using namespace logfw;
+
+namespace {
+
+/* Encode args with both implementations, compare bytes, @return encoded size */
+template< class... Args >
+std::size_t encode_both(char* buffer, const Args&... args)
+{
+    static_assert( std::is_same_v< details::encode_impl_t< fixed_encoding, Args... >, details::fixed_layout_impl< Args... > > );
+    using fixed_impl = details::fixed_layout_impl< Args... >;
+    using generic_impl = details::encode_impl< fixed_encoding, Args... >;
+
+    /* Unused bytes differ, so each offset mismatch is visible */
+    char generic[256];
+    std::memset(buffer, 0xaa, sizeof(generic));
+    std::memset(generic, 0x55, sizeof(generic));
+
+    const std::size_t size = fixed_impl::encode(args..., buffer);
+    CHECK(size == generic_impl::encode(args..., generic));
+    CHECK(size == encoder::encode(generic + size, args...));
+    CHECK(std::memcmp(buffer, generic, size) == 0);
+    CHECK(std::memcmp(buffer, generic + size, size) == 0);
+    return size;
+}
+
+void test_mixed_pack()
+{
+    int object = 0;
+    const char c = 'x';
+    const double d = -1.25e10;
+    const std::int16_t i16 = -12345;
+    void* const ptr = &object;
+    const std::uint64_t u64 = 0x0123456789abcdefull;
+    const float f = 3.5f;
+
+    char buffer[256];
+    const std::size_t size = encode_both(buffer, c, d, i16, ptr, u64, f);
+    CHECK(size == sizeof(c) + sizeof(d) + sizeof(i16) + sizeof(ptr) + sizeof(u64) + sizeof(f));
+
+    decoder dec{buffer, size};
+    char c_value;
+    double d_value;
+    std::int16_t i16_value;
+    void* ptr_value;
+    std::uint64_t u64_value;
+    float f_value;
+    dec.decode(c_value);
+    dec.decode(d_value);
+    dec.decode(i16_value);
+    dec.decode(ptr_value);
+    dec.decode(u64_value);
+    dec.decode(f_value);
+    CHECK(c_value == c);
+    CHECK(d_value == d);
+    CHECK(i16_value == i16);
+    CHECK(ptr_value == ptr);
+    CHECK(u64_value == u64);
+    CHECK(f_value == f);
+    CHECK(dec.take(0) == buffer + size);
+}
+
+void test_other_orders()
+{
+    char buffer[256];
+
+    const std::size_t size = encode_both(buffer, std::uint8_t(200), std::int64_t(-7), true, std::uint32_t(42));
+    decoder dec{buffer, size};
+    std::uint8_t u8;
+    std::int64_t i64;
+    bool b;
+    std::uint32_t u32;
+    dec.decode(u8);
+    dec.decode(i64);
+    dec.decode(b);
+    dec.decode(u32);
+    CHECK(u8 == 200);
+    CHECK(i64 == -7);
+    CHECK(b);
+    CHECK(u32 == 42);
+
+    const std::size_t single = encode_both(buffer, 2.5);
+    CHECK(single == sizeof(double));
+    decoder single_dec{buffer, single};
+    double value;
+    single_dec.decode(value);
+    CHECK(value == 2.5);
+}
+
+} // namespace
+
+int main()
+{
+    test_mixed_pack();
+    test_other_orders();
+    return 0;
+}
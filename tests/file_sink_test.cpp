@@ -0,0 +1,138 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "logfw/backend.hpp"
+#include "logfw/file_sink.hpp"
+#include "logfw/log.hpp"
+#include "test_common.hpp"
+
+/*
+ * Text file sink: records split over chunks are written in order, writev()
+ * of more than IOV_MAX chunks, fsync policies, append and truncate modes.
+ */
+
+using namespace logfw;
+
+namespace {
+
+std::string read_file(const std::string& path)
+{
+    std::ifstream file{path, std::ios::binary};
+    return {std::istreambuf_iterator< char >(file), std::istreambuf_iterator< char >()};
+}
+
+void test_chunks(const std::string& dir)
+{
+    const std::string path = dir + "/chunks.log";
+    std::string expected;
+
+    {
+        file_sink_options options;
+        /* Records span several chunks, buffer is written before flush() */
+        options.chunk_size = 7;
+        options.buffer_size = 100;
+        file_sink sink{path, options};
+        for (int i = 0; i < 1000; ++i) {
+            const std::string record = "record " + std::to_string(i) + "\n";
+            sink.write(record);
+            expected += record;
+        }
+        sink.flush();
+        CHECK(read_file(path) == expected);
+
+        /* More chunks than a single writev() takes */
+        const std::string large(3 * IOV_MAX * options.chunk_size + 3, 'x');
+        sink.write(large);
+        expected += large;
+    }
+
+    CHECK(read_file(path) == expected);
+}
+
+void check_backend(const std::string& path, const file_sink_options& options)
+{
+    const int count = 20000;
+    std::vector< std::string > rendered;
+
+    {
+        backend_options settings;
+        settings.overflow = overflow_policy::block;
+        backend b{settings};
+        b.add_sink< test::capture_sink >(rendered);
+        b.add_sink< file_sink >(path, options);
+        b.start();
+        for (int i = 0; i < count; ++i) {
+            LOGFW_INFO(b, "test", "record {} {}", i, std::string_view("some payload text"));
+        }
+        b.stop();
+    }
+
+    CHECK(rendered.size() == std::size_t(count));
+    std::string expected;
+    for (const auto& line: rendered) {
+        expected += line;
+        expected += '\n';
+    }
+    CHECK(read_file(path) == expected);
+}
+
+void test_fsync(const std::string& dir)
+{
+    file_sink_options options;
+    options.chunk_size = 4096;
+    options.buffer_size = 64 * 1024;
+
+    options.fsync = fsync_policy::never;
+    check_backend(dir + "/never.log", options);
+
+    options.fsync = fsync_policy::interval;
+    options.fsync_interval = std::chrono::milliseconds(1);
+    check_backend(dir + "/interval.log", options);
+
+    options.fsync = fsync_policy::bytes;
+    options.fsync_bytes = 16 * 1024;
+    check_backend(dir + "/bytes.log", options);
+}
+
+void test_append(const std::string& dir)
+{
+    const std::string path = dir + "/append.log";
+
+    {
+        file_sink sink{path};
+        sink.write("first\n");
+    }
+    {
+        file_sink_options options;
+        options.append = true;
+        file_sink sink{path, options};
+        sink.write("second\n");
+    }
+    CHECK(read_file(path) == "first\nsecond\n");
+
+    /* File is truncated without append */
+    {
+        file_sink sink{path};
+        sink.write("third\n");
+    }
+    CHECK(read_file(path) == "third\n");
+}
+
+} // namespace
+
+int main()
+{
+    const std::string dir = test::make_temp_dir();
+    test_chunks(dir);
+    test_fsync(dir);
+    test_append(dir);
+    test::remove_temp_dir(dir);
+    return 0;
+}
@@ -0,0 +1,146 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logfw/backend.hpp"
+#include "logfw/log.hpp"
+#include "test_common.hpp"
+
+/*
+ * Full queue handling (overflow_policy): records kept in order, dropped
+ * records reported and counted.
+ */
+
+using namespace logfw;
+
+namespace {
+
+backend_options make_options(overflow_policy policy, std::size_t capacity)
+{
+    backend_options options;
+    options.queue_capacity = capacity;
+    options.overflow = policy;
+    options.overflow_spin_count = 100;
+    options.timestamps = false;
+    return options;
+}
+
+/* Log count records into a small queue before backend is started */
+void log_before_start(overflow_policy policy, int count, std::vector< std::string >& lines, backend_stats& stats)
+{
+    backend b{make_options(policy, 1024)};
+    b.add_sink< test::capture_sink >(lines);
+
+    std::thread([&b, count] {
+        for (int i = 0; i < count; ++i) {
+            LOGFW_INFO(b, "test", "record {}", i);
+        }
+    }).join();
+
+    /* Backend takes over overflow state of the exited thread */
+    b.start();
+    b.stop();
+    stats = b.stats();
+}
+
+void check_dropped(overflow_policy policy)
+{
+    const int count = 100;
+    std::vector< std::string > lines;
+    backend_stats stats;
+    log_before_start(policy, count, lines, stats);
+
+    CHECK(stats.dropped > 0);
+    const std::size_t kept = count - stats.dropped;
+    CHECK(stats.records == kept);
+    CHECK(lines.size() == kept + 1);
+    for (std::size_t i = 0; i < kept; ++i) {
+        CHECK(lines[i] == "record " + std::to_string(i));
+    }
+    CHECK(lines.back() == std::to_string(stats.dropped) + " records dropped");
+}
+
+void test_drop()
+{
+    check_dropped(overflow_policy::drop);
+}
+
+void test_spin()
+{
+    check_dropped(overflow_policy::spin);
+}
+
+void test_spill()
+{
+    const int count = 5000;
+    std::vector< std::string > lines;
+    backend_stats stats;
+    log_before_start(overflow_policy::spill, count, lines, stats);
+
+    CHECK(stats.dropped == 0);
+    CHECK(stats.spilled > 0);
+    CHECK(stats.records == std::size_t(count));
+    CHECK(lines.size() == std::size_t(count));
+    for (int i = 0; i < count; ++i) {
+        CHECK(lines[i] == "record " + std::to_string(i));
+    }
+}
+
+void test_block()
+{
+    const int count = 20000;
+    std::vector< std::string > lines;
+
+    backend b{make_options(overflow_policy::block, 1024)};
+    b.add_sink< test::capture_sink >(lines);
+    b.start();
+    std::thread([&b] {
+        for (int i = 0; i < count; ++i) {
+            LOGFW_INFO(b, "test", "record {}", i);
+        }
+    }).join();
+    b.stop();
+
+    CHECK(b.stats().dropped == 0);
+    CHECK(lines.size() == std::size_t(count));
+    for (int i = 0; i < count; ++i) {
+        CHECK(lines[i] == "record " + std::to_string(i));
+    }
+}
+
+void test_block_never_fits()
+{
+    std::vector< std::string > lines;
+
+    backend b{make_options(overflow_policy::block, 1024)};
+    b.add_sink< test::capture_sink >(lines);
+    b.start();
+    std::thread([&b] {
+        const std::string s(3000, 'x');
+        LOGFW_INFO(b, "test", "{}{}{}{}", s, s, s, s);
+        CHECK(b.local_stats().dropped == 1);
+        LOGFW_INFO(b, "test", "after {}", 1);
+    }).join();
+    b.stop();
+
+    CHECK(b.stats().dropped == 1);
+    CHECK(lines.size() == 2);
+    CHECK(lines[0] == "1 records dropped");
+    CHECK(lines[1] == "after 1");
+}
+
+} // namespace
+
+int main()
+{
+    test_drop();
+    test_spin();
+    test_spill();
+    test_block();
+    test_block_never_fits();
+    return 0;
+}
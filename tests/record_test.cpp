@@ -0,0 +1,76 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+#include "logfw/format_registry.hpp"
+#include "logfw/record.hpp"
+#include "logfw/spsc_ring.hpp"
+#include "test_common.hpp"
+
+/*
+ * Record enqueue: exact size is reserved for records with strings, the
+ * tail of the ring is used instead of being skipped.
+ */
+
+using namespace logfw;
+
+namespace {
+
+void test_string_record_space()
+{
+    LOGFW_DEFINE_SITE(string_site, "value {}");
+    const std::string_view value = "abcdefghij";
+    static_assert( record_encoder::variable_size< std::string_view >() );
+    static_assert( record_encoder::variable_size< int, const char* >() );
+    static_assert( !record_encoder::variable_size< int, double >() );
+
+    /* Ring over zeroed memory, skipped tail is marked in the memory */
+    const std::size_t capacity = 16384;
+    const std::size_t memory_size = spsc_ring::memory_size(capacity);
+    std::unique_ptr< char[] > storage{new char[memory_size + LOGFW_CACHE_LINE_SIZE]};
+    const auto address = reinterpret_cast< std::uintptr_t >(storage.get());
+    char* memory = storage.get() + (LOGFW_CACHE_LINE_SIZE - address % LOGFW_CACHE_LINE_SIZE);
+    std::memset(memory, 0, memory_size);
+    spsc_ring::init(memory);
+    spsc_ring ring{memory, capacity};
+
+    /* Frame header and alignment of spsc_ring */
+    const std::size_t frame = (sizeof(std::uint32_t) + record_bytes_required(value) + 7) & ~std::size_t(7);
+    CHECK(capacity % frame == 0);
+
+    /* Two laps over the ring, frames fill it without gaps */
+    for (std::size_t i = 0; i < 2 * capacity / frame; ++i) {
+        CHECK(enqueue_record< string_site >(ring, value) != 0);
+        std::size_t size;
+        CHECK(ring.front(size));
+        CHECK(size == record_bytes_required(value));
+        ring.pop();
+    }
+
+    const char* data = memory + memory_size - capacity;
+    for (std::size_t offset = 0; offset < capacity; offset += frame) {
+        std::uint32_t header;
+        std::memcpy(&header, data + offset, sizeof(header));
+        CHECK(header == record_bytes_required(value));
+    }
+
+    /* Empty ring takes exactly capacity / frame records */
+    std::size_t count = 0;
+    while (enqueue_record< string_site >(ring, value) != 0) {
+        ++count;
+    }
+    CHECK(count == capacity / frame);
+}
+
+} // namespace
+
+int main()
+{
+    test_string_record_space();
+    return 0;
+}
@@ -0,0 +1,223 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "logfw/backend.hpp"
+#include "logfw/log.hpp"
+#include "logfw/rotating_file_sink.hpp"
+#include "test_common.hpp"
+
+/*
+ * Rotating binary log segments: records are split over segments in order
+ * or counted as dropped, live segment is readable up to end marker, age
+ * rotation happens without traffic, failed open is retried later.
+ */
+
+using namespace logfw;
+
+namespace {
+
+std::string segment_path(const std::string& prefix, int sequence)
+{
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%06d", sequence);
+    return prefix + suffix;
+}
+
+/* @return true if segment has file header, next segment is opened ahead and zero filled */
+bool started(const std::string& path)
+{
+    char data[sizeof(binary::magic)] = {};
+    std::ifstream file{path, std::ios::binary};
+    file.read(data, sizeof(data));
+    return std::memcmp(data, binary::magic, sizeof(data)) == 0;
+}
+
+/* Wait for condition up to 5 seconds */
+template< class F >
+bool wait_for(F&& f)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!f()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+/* Records are rendered too, backend_stats::formatted tells how many are consumed */
+backend_options make_options()
+{
+    backend_options options;
+    options.overflow = overflow_policy::block;
+    options.idle_flush_interval = std::chrono::milliseconds(10);
+    return options;
+}
+
+void test_rotation(const std::string& dir)
+{
+    const std::string prefix = dir + "/size";
+    const int count = 50000;
+    std::vector< std::string > rendered;
+    std::uint64_t dropped = 0;
+
+    {
+        backend b{make_options()};
+        b.add_sink< test::capture_sink >(rendered);
+        rotating_file_sink_options options;
+        options.segment_size = 256 * 1024;
+        auto& sink = b.add_sink< rotating_file_sink >(prefix, options);
+        b.start();
+        for (int i = 0; i < count; ++i) {
+            LOGFW_INFO(b, "test", "record {} {}", i, std::string_view("some payload text"));
+        }
+
+        /* Segment in use is preallocated, records are followed by end marker */
+        CHECK(wait_for([&b] {
+            return b.stats().formatted == std::uint64_t(count);
+        }));
+        int last = 0;
+        while (started(segment_path(prefix, last + 1))) {
+            ++last;
+        }
+        std::vector< std::string > live;
+        CHECK(test::read_binary_log(segment_path(prefix, last), live));
+        CHECK(!live.empty());
+        CHECK(live.back().compare(0, 7, "record ") == 0);
+
+        b.stop();
+        dropped = sink.dropped();
+    }
+
+    /* Closed segments are truncated to used size, unused next segment is removed */
+    int written = 0;
+    int expected = 0;
+    int segments = 0;
+    for (; test::file_size(segment_path(prefix, segments)) > 0; ++segments) {
+        const std::string path = segment_path(prefix, segments);
+        CHECK(test::file_size(path) <= 256 * 1024);
+
+        std::vector< std::string > lines;
+        CHECK(test::read_binary_log(path, lines));
+        CHECK(!lines.empty());
+        /* Records are dropped if the next segment is not ready on rotation */
+        for (const auto& line: lines) {
+            while (expected < count && line != "record " + std::to_string(expected) + " some payload text") {
+                ++expected;
+            }
+            CHECK(expected < count);
+            ++expected;
+            ++written;
+        }
+    }
+    CHECK(segments > 2);
+    CHECK(written + dropped == std::uint64_t(count));
+}
+
+void test_max_age(const std::string& dir)
+{
+    const std::string prefix = dir + "/age";
+
+    {
+        backend b{make_options()};
+        rotating_file_sink_options options;
+        options.segment_size = 1024 * 1024;
+        options.max_age = std::chrono::seconds(1);
+        b.add_sink< rotating_file_sink >(prefix, options);
+        b.start();
+
+        for (int i = 0; i < 5; ++i) {
+            LOGFW_INFO(b, "test", "age {}", i);
+        }
+
+        /* No more records, idle flush rotates, the first segment is truncated on close */
+        CHECK(wait_for([&prefix] {
+            return test::file_size(segment_path(prefix, 0)) < 1024 * 1024;
+        }));
+
+        /* Age of the next segment is counted from rotation, not from its opening */
+        LOGFW_INFO(b, "test", "age {}", 5);
+    }
+
+    std::vector< std::string > first;
+    CHECK(test::read_binary_log(segment_path(prefix, 0), first));
+    CHECK(first.size() == 5);
+    std::vector< std::string > second;
+    CHECK(test::read_binary_log(segment_path(prefix, 1), second));
+    CHECK(second.size() == 1);
+    CHECK(second[0] == "age 5");
+    CHECK(test::file_size(segment_path(prefix, 2)) == 0);
+}
+
+void test_open_failure(const std::string& dir)
+{
+    const std::string segments = dir + "/failure";
+    CHECK(::mkdir(segments.c_str(), 0755) == 0);
+    const std::string prefix = segments + "/seg";
+
+    const int count = 20000;
+    std::vector< std::string > rendered;
+
+    {
+        backend b{make_options()};
+        b.add_sink< test::capture_sink >(rendered);
+        rotating_file_sink_options options;
+        options.segment_size = 64 * 1024;
+        options.retry_interval = std::chrono::milliseconds(100);
+        auto& sink = b.add_sink< rotating_file_sink >(prefix, options);
+        b.start();
+
+        /* Current and prepared next segments are open, following ones fail */
+        test::remove_temp_dir(segments);
+        for (int i = 0; i < count; ++i) {
+            LOGFW_INFO(b, "test", "record {} {}", i, std::string_view("some payload text"));
+        }
+        CHECK(wait_for([&b] {
+            return b.stats().formatted == std::uint64_t(count);
+        }));
+        const std::uint64_t dropped = sink.dropped();
+        CHECK(dropped > 0);
+        CHECK(dropped < std::uint64_t(count));
+
+        /* Sink recovers once segments could be created again */
+        CHECK(::mkdir(segments.c_str(), 0755) == 0);
+        std::this_thread::sleep_for(options.retry_interval * 2);
+        LOGFW_INFO(b, "test", "recovered {}", 1);
+        b.stop();
+        CHECK(sink.dropped() == dropped);
+    }
+
+    std::vector< std::string > lines;
+    for (int sequence = 0; sequence < 100; ++sequence) {
+        const std::string path = segment_path(prefix, sequence);
+        if (test::file_size(path) > 0) {
+            CHECK(test::read_binary_log(path, lines));
+        }
+    }
+    CHECK(lines.size() == 1);
+    CHECK(lines[0] == "recovered 1");
+}
+
+} // namespace
+
+int main()
+{
+
+    const std::string dir = test::make_temp_dir();
+    test_rotation(dir);
+    test_max_age(dir);
+    test_open_failure(dir);
+    test::remove_temp_dir(dir);
+    return 0;
+}
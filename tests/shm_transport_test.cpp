@@ -0,0 +1,112 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "logfw/format_program.hpp"
+#include "logfw/log.hpp"
+#include "logfw/shm_transport.hpp"
+#include "test_common.hpp"
+
+/*
+ * Shared memory transport: producer queue slots, consumer checks of
+ * the shared dictionary.
+ */
+
+using namespace logfw;
+
+namespace {
+
+shm_options make_options(const std::string& name)
+{
+    shm_options options;
+    options.name = "/logfw_test." + std::to_string(::getpid()) + "." + name;
+    options.max_queues = 1;
+    options.queue_capacity = 256 * 1024;
+    return options;
+}
+
+/* Render all records of the consumer */
+std::vector< std::string > consume(shm_consumer& consumer)
+{
+    std::vector< std::string > lines;
+    program_cache programs;
+    buffer buf;
+    consumer.poll([&](const record_header& header, const char* payload) {
+        const format_info* info = consumer.find(header.format);
+        CHECK(info);
+        buf.clear();
+        programs.get(header.format, info->format).run< record_encoding >(buf, payload, header.size);
+        lines.emplace_back(buf.str());
+    }, 1000000);
+    return lines;
+}
+
+void test_several_producers()
+{
+    const int count = 1000;
+
+    /* Single slot each, thread keeps its slot while switching producers */
+    shm_producer first{make_options("first")};
+    shm_producer second{make_options("second")};
+    shm_consumer first_consumer{first.name()};
+    first_consumer.unlink();
+    shm_consumer second_consumer{second.name()};
+    second_consumer.unlink();
+
+    std::thread([&] {
+        for (int i = 0; i < count; ++i) {
+            LOGFW_INFO(first, "test", "first {}", i);
+            LOGFW_INFO(second, "test", "second {}", i);
+        }
+    }).join();
+
+    const std::vector< std::string > first_lines = consume(first_consumer);
+    const std::vector< std::string > second_lines = consume(second_consumer);
+    CHECK(first_lines.size() == std::size_t(count));
+    CHECK(second_lines.size() == std::size_t(count));
+    for (int i = 0; i < count; ++i) {
+        CHECK(first_lines[i] == "first " + std::to_string(i));
+        CHECK(second_lines[i] == "second " + std::to_string(i));
+    }
+}
+
+void test_corrupted_dictionary()
+{
+    shm_producer producer{make_options("dictionary")};
+    shm_consumer consumer{producer.name()};
+    details::shm_mapping mapping{producer.name(), 0};
+    consumer.unlink();
+
+    /* Entry with id far beyond the number of entries */
+    details::shm_header& header = mapping.header();
+    const std::uint64_t size = header.dictionary_size.load();
+    binary::dictionary_entry entry{};
+    entry.id = 0xfffffff0;
+    std::memcpy(mapping.data() + header.dictionary_offset + size, &entry, sizeof(entry));
+    header.dictionary_size.store(size + sizeof(entry));
+
+    std::string error;
+    try {
+        consumer.find(entry.id);
+    } catch (const std::runtime_error& e) {
+        error = e.what();
+    }
+    CHECK(error == "Corrupted dictionary");
+}
+
+} // namespace
+
+int main()
+{
+    test_several_producers();
+    test_corrupted_dictionary();
+    return 0;
+}
@@ -0,0 +1,106 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#ifndef KSERGEY_test_common_171018203115
+#define KSERGEY_test_common_171018203115
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logfw/binary_reader.hpp"
+#include "logfw/format_program.hpp"
+#include "logfw/sink.hpp"
+
+/* Check condition, exit with failure if it doesn't hold (also in release builds) */
+#define CHECK(expr)                                                                                 \
+    do {                                                                                            \
+        if (!(expr)) {                                                                              \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr);           \
+            std::exit(1);                                                                           \
+        }                                                                                           \
+    } while (false)
+
+namespace logfw::test {
+
+/** Keeps rendered records (without trailing new line) */
+class capture_sink final
+    : public sink
+{
+private:
+    std::vector< std::string >& lines_;
+
+public:
+    explicit capture_sink(std::vector< std::string >& lines)
+        : lines_(lines)
+    {}
+
+    void write(std::string_view record) override
+    {
+        if (!record.empty() && record.back() == '\n') {
+            record.remove_suffix(1);
+        }
+        lines_.emplace_back(record);
+    }
+};
+
+/**
+ * Render records of binary log file.
+ * @return false if the file ends with incomplete record
+ */
+inline bool read_binary_log(const std::string& path, std::vector< std::string >& lines)
+{
+    binary::file_reader reader{path};
+    program_cache programs;
+    buffer buf;
+
+    record_header header;
+    const char* payload;
+    while (reader.next(header, payload)) {
+        const format_info* info = reader.find(header.format);
+        if (!info) {
+            throw std::runtime_error("Unknown format id");
+        }
+        buf.clear();
+        programs.get(header.format, info->format).run< record_encoding >(buf, payload, header.size);
+        lines.emplace_back(buf.str());
+    }
+    return !reader.truncated();
+}
+
+/** @return File size, zero if there is no file */
+inline std::size_t file_size(const std::string& path)
+{
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+/** @return Path of a new empty temporary directory */
+inline std::string make_temp_dir()
+{
+    char path[] = "/tmp/logfw_test.XXXXXX";
+    if (!::mkdtemp(path)) {
+        std::perror("mkdtemp");
+        std::exit(1);
+    }
+    return path;
+}
+
+/** Remove directory created with make_temp_dir() */
+inline void remove_temp_dir(const std::string& path)
+{
+    const std::string command = "rm -rf '" + path + "'";
+    if (std::system(command.c_str()) != 0) {
+        std::fprintf(stderr, "Failed to remove %s\n", path.c_str());
+    }
+}
+
+} // namespace logfw::test
+
+#endif /* KSERGEY_test_common_171018203115 */
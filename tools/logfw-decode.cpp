@@ -0,0 +1,129 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string_view>
+
+#include "logfw/binary_reader.hpp"
+#include "logfw/buffer.hpp"
+#include "logfw/clock.hpp"
+#include "logfw/format_program.hpp"
+#include "logfw/literal.hpp"
+
+using namespace logfw;
+
+namespace {
+
+void usage(const char* name)
+{
+    std::fprintf(stderr,
+            "Usage: %s [-l] [-t] FILE...\n"
+            "Decode binary log files to stdout\n"
+            "\n"
+            "  -l  prefix each record with source location\n"
+            "  -t  prefix each record with wall-clock time (UTC)\n",
+            name);
+}
+
+void output(buffer& buf)
+{
+    std::fwrite(buf.data(), 1, buf.size(), stdout);
+    buf.clear();
+}
+
+void decode(const char* path, bool location, bool timestamps)
+{
+    binary::file_reader reader{path};
+    literal_scope< binary::file_reader > literals{reader};
+    program_cache programs;
+    buffer buf{64 * 1024};
+    timestamp_formatter timestamp;
+    const bool compact = reader.encoding() == LOGFW_ENCODING_COMPACT;
+
+    record_header header;
+    const char* payload;
+    while (reader.next(header, payload)) {
+        const format_info* info = reader.find(header.format);
+
+        if (timestamps && reader.calibrated()) {
+            timestamp.format(buf, reader.to_realtime(header.timestamp));
+            buf.push_back(' ');
+        }
+
+        try {
+            if (LOGFW_UNLIKELY(!info)) {
+                throw std::runtime_error("Unknown format id");
+            }
+
+            if (location && !info->file.empty()) {
+                buf.append(info->file);
+                buf.push_back(':');
+                char line[16];
+                buf.append(line, std::snprintf(line, sizeof(line), "%u", info->line));
+                buf.append(": ");
+            }
+
+            const format_program& program = programs.get(header.format, info->format);
+            if (compact) {
+                program.run< compact_encoding >(buf, payload, header.size);
+            } else {
+                program.run(buf, payload, header.size);
+            }
+        } catch (const std::exception& e) {
+            buf.append("<format error: ");
+            buf.append(e.what());
+            buf.push_back('>');
+        }
+        buf.push_back('\n');
+
+        if (buf.size() >= 60 * 1024) {
+            output(buf);
+        }
+    }
+
+    output(buf);
+
+    if (reader.truncated()) {
+        std::fprintf(stderr, "%s: last record is incomplete\n", path);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    bool location = false;
+    bool timestamps = false;
+
+    int index = 1;
+    for (; index < argc && argv[index][0] == '-'; ++index) {
+        if (std::strcmp(argv[index], "-l") == 0) {
+            location = true;
+        } else if (std::strcmp(argv[index], "-t") == 0) {
+            timestamps = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (index == argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int rc = 0;
+    for (; index < argc; ++index) {
+        try {
+            decode(argv[index], location, timestamps);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s: %s\n", argv[index], e.what());
+            rc = 1;
+        }
+    }
+
+    return rc;
+}
@@ -0,0 +1,156 @@
+// ------------------------------------------------------------
+// Copyright (c) 2018 Sergey Kovalevich <inndie@gmail.com>
+// ------------------------------------------------------------
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <thread>
+
+#include "logfw/buffer.hpp"
+#include "logfw/clock.hpp"
+#include "logfw/format_program.hpp"
+#include "logfw/literal.hpp"
+#include "logfw/shm_transport.hpp"
+
+using namespace logfw;
+
+namespace {
+
+void usage(const char* name)
+{
+    std::fprintf(stderr,
+            "Usage: %s [-k] [-t] NAME\n"
+            "Format records from shared memory object NAME to stdout\n"
+            "until the producer process exits\n"
+            "\n"
+            "  -k  keep shared memory object on exit\n"
+            "  -t  prefix each record with wall-clock time (UTC)\n",
+            name);
+}
+
+void output(buffer& buf)
+{
+    std::fwrite(buf.data(), 1, buf.size(), stdout);
+    std::fflush(stdout);
+    buf.clear();
+}
+
+/* Wait until producer finishes initialization */
+std::unique_ptr< shm_consumer > attach(const char* name)
+{
+    for (int attempt = 0;; ++attempt) {
+        try {
+            return std::make_unique< shm_consumer >(name);
+        } catch (const std::exception&) {
+            if (attempt == 50) {
+                throw;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+}
+
+void consume(const char* name, bool keep, bool timestamps)
+{
+    auto consumer = attach(name);
+    literal_scope< shm_consumer > literals{*consumer};
+    program_cache programs;
+    buffer buf{64 * 1024};
+
+    const bool compact = consumer->encoding() == LOGFW_ENCODING_COMPACT;
+
+    /* Record clock is shared with the producer on the same host */
+    timestamps = timestamps && consumer->same_clock();
+    clock_calibration calibration;
+    auto next_calibration = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    timestamp_formatter timestamp;
+
+    auto render = [&](const record_header& header, const char* payload) {
+        const format_info* info = consumer->find(header.format);
+
+        if (timestamps) {
+            timestamp.format(buf, calibration.to_realtime(header.timestamp));
+            buf.push_back(' ');
+        }
+
+        try {
+            if (LOGFW_UNLIKELY(!info)) {
+                throw std::runtime_error("Unknown format id");
+            }
+            const format_program& program = programs.get(header.format, info->format);
+            if (compact) {
+                program.run< compact_encoding >(buf, payload, header.size);
+            } else {
+                program.run(buf, payload, header.size);
+            }
+        } catch (const std::exception& e) {
+            buf.append("<format error: ");
+            buf.append(e.what());
+            buf.push_back('>');
+        }
+        buf.push_back('\n');
+    };
+
+    while (true) {
+        /* Check before polling, so records written before exit are drained */
+        const bool alive = consumer->producer_alive();
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= next_calibration) {
+            calibration.update();
+            next_calibration = now + std::chrono::seconds(1);
+        }
+
+        const std::size_t count = consumer->poll(render);
+        if (!buf.empty()) {
+            output(buf);
+        }
+
+        if (count == 0) {
+            if (!alive) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    if (!keep) {
+        consumer->unlink();
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    bool keep = false;
+    bool timestamps = false;
+
+    int index = 1;
+    for (; index < argc && argv[index][0] == '-'; ++index) {
+        if (std::strcmp(argv[index], "-k") == 0) {
+            keep = true;
+        } else if (std::strcmp(argv[index], "-t") == 0) {
+            timestamps = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (index + 1 != argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        consume(argv[index], keep, timestamps);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s: %s\n", argv[index], e.what());
+        return 1;
+    }
+
+    return 0;
+}